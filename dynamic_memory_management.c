@@ -1,53 +1,644 @@
 /**
  * 动态分区管理模拟程序
- * 实现最先适应、最佳适应和最坏适应三种内存分配算法
+ * 实现最先适应、最佳适应、最坏适应和循环首次适应四种内存分配算法，以及伙伴系统、分层位图和TLSF分配引擎
  */
 
 #include <stdio.h>       // 标准输入输出库
 #include <stdlib.h>      // 标准库函数，提供内存分配和程序控制功能
 #include <string.h>      // 字符串处理函数库
+#include <stddef.h>      // 提供offsetof宏，用于由树节点找回所在分区
 #include <windows.h>     // Windows API函数库，用于控制台操作
 #include <time.h>        // 时间函数库，用于随机数生成
 #include <math.h>        // 用于abs()函数
+#include <limits.h>      // 提供LLONG_MAX，用作求最小值的初值
+
+// x86上的GCC/MinGW提供SSE2/AVX2内建函数，可按函数单独启用指令集并在运行时检测CPU
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define FIT_SIMD_X86 1
+#endif
+
+// 编译时定义ALLOC_PROFILE（gcc -DALLOC_PROFILE）启用分配器的延迟直方图：按操作和算法记录每次调用的耗时，
+// 并统计每次查找访问的节点数。未定义时下面的宏展开为空，统计代码全部编译掉
+#ifdef ALLOC_PROFILE
+#define PROFILE_START() unsigned long long profile_start = profile_begin()
+#define PROFILE_STOP(op) profile_record((op), profile_ticks() - profile_start)
+#define PROFILE_VISIT() (profile_nodes_visited++)
+#else
+#define PROFILE_START()
+#define PROFILE_STOP(op)
+#define PROFILE_VISIT()
+#endif
 
 // 内存分区状态常量定义
 #define FREE 0    // 空闲状态标识
 #define BUSY 1    // 已分配状态标识
+#define CACHED 2  // 已释放但暂存在前端缓存中、尚未合并的分区
+
+// 空闲分区和空闲块的进程号，显示时对应名称"空闲"；进程名驻留后从1开始编号
+#define FREE_PROCESS_ID 0
 
 // 内存分配算法类型常量定义
 #define FIRST_FIT 1   // 最先适应算法标识
 #define BEST_FIT  2   // 最佳适应算法标识
 #define WORST_FIT 3   // 最坏适应算法标识
+#define NEXT_FIT  4   // 循环首次适应算法标识
+#define BUDDY_SYSTEM 5 // 伙伴系统标识（使用独立的伙伴分配引擎）
+#define BITMAP_SYSTEM 6 // 位图分配标识（使用独立的分层位图分配引擎）
+#define TLSF_SYSTEM 7   // 两级分离适应标识（使用独立的TLSF分配引擎）
+
+// 空闲分区按大小分级索引的级数：第k级存放大小在[2^k, 2^(k+1))范围内的空闲分区
+// 地址和大小都是64位整数，最多需要64级
+#define SIZE_CLASS_COUNT 64
+
+// 伙伴系统的阶数：第k阶的块大小为2^k KB
+#define BUDDY_ORDER_COUNT 63
+
+// 位图最多的粒度块数：内存更大时把粒度加倍，位图本身不超过8MB
+#define BITMAP_MAX_GRANULES (1LL << 26)
+
+// 位图摘要每个节点的子节点数（2^BITMAP_FANOUT_SHIFT）：第0层节点的子节点是粒度位图的字，
+// 往上每层节点的子节点是下一层的节点。子节点越多层数越少，但每次更新和查找每层要看的子节点越多
+#define BITMAP_FANOUT_SHIFT 4
+#define BITMAP_FANOUT (1 << BITMAP_FANOUT_SHIFT)
+
+// 位图摘要的最大层数
+#define BITMAP_MAX_LEVELS 12
+
+// TLSF的一级数：一级按大小的最高位分级，64位大小最多需要64级
+#define TLSF_FL_COUNT 64
+
+// TLSF每个一级再等分成的二级数（2^TLSF_SL_SHIFT），大小小于TLSF_SL_COUNT的块全部放在第0个一级中逐个大小分级
+#define TLSF_SL_SHIFT 5
+#define TLSF_SL_COUNT (1 << TLSF_SL_SHIFT)
+
+// 前端缓存只暂存不超过该大小(KB)的分区，每个大小一个缓存桶
+#define FRONT_CACHE_MAX_SIZE 256
+
+// 每个缓存桶最多暂存的分区数
+#define FRONT_CACHE_BIN_LIMIT 16
+
+// 暂存的分区总大小不超过全部内存段的1/FRONT_CACHE_MEMORY_SHARE
+#define FRONT_CACHE_MEMORY_SHARE 8
+
+// 释放时外部碎片率超过该值就清空前端缓存，把暂存的分区合并回空闲分区索引
+#define FRONT_CACHE_MAX_FRAGMENTATION 0.8
+
+// 延迟合并时默认累计多少次未合并的释放后做一次合并扫描
+#define LAZY_COALESCE_THRESHOLD 256
+
+// 进程索引哈希表的初始桶数（必须是2的幂）
+#define PROCESS_TABLE_INITIAL_SIZE 64
+
+// 批量分配时不超过该数量的请求在栈上排序，不申请堆内存
+#define BATCH_LOCAL_ITEMS 256
+
+// 性能测试负载的请求大小分布
+#define DIST_UNIFORM     0   // 均匀分布
+#define DIST_EXPONENTIAL 1   // 指数分布
+#define DIST_BIMODAL     2   // 双峰分布：大量小请求夹杂少量大请求
+#define DIST_POWERLAW    3   // 幂律（帕累托）分布：长尾
+#define DIST_COUNT       4
+
+// 性能测试中外部碎片率的采样次数
+#define FRAGMENTATION_SAMPLES 10
+
+// 延迟直方图统计的操作
+#define PROFILE_ALLOCATE 0   // allocate_memory
+#define PROFILE_SEARCH   1   // find_free_partition，即first_fit/best_fit/worst_fit/next_fit
+#define PROFILE_RELEASE  2   // release_memory
+#define PROFILE_MERGE    3   // merge_free_partitions
+#define PROFILE_OP_COUNT 4
+
+// 延迟直方图按数值的最高位对数分桶，每个2的幂区间再等分成2^PROFILE_SUB_SHIFT个桶，
+// 分位数的相对误差不超过1/2^PROFILE_SUB_SHIFT
+#define PROFILE_SUB_SHIFT 2
+#define PROFILE_BUCKETS (64 << PROFILE_SUB_SHIFT)
+
+// 节点池每次向系统申请的节点数
+#define POOL_CHUNK_NODES 4096
+
+// 数组分区表每块最多容纳的分区数
+#define TABLE_CHUNK_CAPACITY 256
+
+// 快照文件的标识（含结尾的'\0'共8字节）和格式版本
+#define SNAPSHOT_MAGIC "DMMSNAP"
+#define SNAPSHOT_VERSION 2
+
+// 二进制轨迹文件的标识（含结尾的'\0'共8字节）和格式版本，请求式分页程序使用同样的格式
+#define TRACE_MAGIC "DMMTRCE"
+#define TRACE_VERSION 1
+
+// 二进制轨迹的记录类型
+#define TRACE_ALLOC  1   // 分配：进程申请内存
+#define TRACE_FREE   2   // 释放：进程的全部内存
+#define TRACE_ACCESS 3   // 页面访问：(操作, 页号, 页内地址)，与请求式分页程序的Instruction相同
+
+// 合成负载中进程访问页面的局部性模型
+#define LOCALITY_WORKING_SET 0  // 在工作集窗口内随机访问，窗口偶尔整体移动（阶段变化）
+#define LOCALITY_LOOP        1  // 循环访问固定的一段页面
+#define LOCALITY_SEQUENTIAL  2  // 顺序扫描进程的全部页面，到末尾后从头开始
+#define LOCALITY_COUNT       3
+#define LOCALITY_MIXED       LOCALITY_COUNT  // 每个进程随机选择一种模型
+
+// 工作集模型每次访问后窗口移动到新位置的概率的倒数
+#define WORKING_SET_PHASE_LENGTH 256
+
+// 节点池中一整块内存的头部，后面紧跟POOL_CHUNK_NODES个节点
+typedef struct pool_chunk {
+    struct pool_chunk *next;  // 下一块
+} PoolChunk;
+
+// 定长节点池：按块批量申请内存，回收的节点挂在空闲链表上重复使用
+typedef struct {
+    size_t node_size;         // 每个节点的大小（字节）
+    void *free_nodes;         // 回收节点链表，节点开头存放下一个回收节点的指针
+    PoolChunk *chunks;        // 已申请的全部块
+    char *next_unused;        // 当前块中第一个尚未使用的节点
+    int unused_count;         // 当前块中尚未使用的节点数
+} NodePool;
+
+// 数组分区表的一块：按地址顺序连续存放分区，起始地址、大小、状态分别存放在独立的数组中，
+// 查找时只顺序读取大小和状态数组。块满时对半分裂，插入和删除只移动块内的元素
+typedef struct table_chunk {
+    int count;                                       // 块中的分区数
+    long long start_addr[TABLE_CHUNK_CAPACITY];      // 起始地址
+    long long size[TABLE_CHUNK_CAPACITY];            // 大小(KB)
+    unsigned char status[TABLE_CHUNK_CAPACITY];      // 状态：FREE或BUSY
+    long long free_size[TABLE_CHUNK_CAPACITY];       // 空闲分区的大小，已分配分区为0，供向量化查找使用
+    unsigned int process_id[TABLE_CHUNK_CAPACITY];   // 占用进程号，空闲为FREE_PROCESS_ID
+    struct table_chunk *next;                        // 地址更高的下一块
+} TableChunk;
+
+// 查找空闲块的内核：在打包的空闲大小数组（已分配的位置为0）上做比较和归约
+typedef struct {
+    const char *name;                               // 指令集名称
+    int (*first_ge)(const long long *a, int n, long long x);        // 第一个不小于x的元素的下标，没有返回-1
+    long long (*min_ge)(const long long *a, int n, long long x);    // 不小于x的元素中的最小值，没有返回0
+    long long (*max)(const long long *a, int n);                    // 最大值，n为0时返回0
+} FitKernels;
+
+// 平衡二叉树（AVL树）节点，嵌入在分区结构体中使用
+typedef struct tree_node {
+    struct tree_node *left;   // 左子树
+    struct tree_node *right;  // 右子树
+    int height;               // 以该节点为根的子树高度
+} TreeNode;
 
 // 内存分区表项结构定义
 typedef struct partition {
-    int start_addr;        // 分区起始地址
-    int size;              // 分区大小(KB)
+    long long start_addr;  // 分区起始地址
+    long long size;        // 分区大小(KB)
     int status;            // 分区状态：FREE或BUSY
-    char process_name[20]; // 占用该分区的进程名称
+    unsigned int process_id; // 占用该分区的进程号（驻留的进程名编号），空闲为FREE_PROCESS_ID
     struct partition *next;// 指向下一个分区的指针，形成链表结构
+    struct partition *prev;// 指向前一个分区的指针，与next一起构成双向链表
+    struct partition *free_prev; // 同一大小级空闲链表中的前一个空闲分区
+    struct partition *free_next; // 同一大小级空闲链表中的后一个空闲分区；暂存在前端缓存中时为同一缓存桶中的下一个分区
+    TreeNode size_node;    // 空闲分区按(大小, 起始地址)排序的平衡树节点
+    TreeNode addr_node;    // 全部分区按起始地址排序的平衡树节点
+    struct partition *owner_prev; // 同一进程占用的分区链表中的前一个分区
+    struct partition *owner_next; // 同一进程占用的分区链表中的后一个分区
+    struct partition *free_min;   // 空闲分区平衡树中以该分区为根的子树内起始地址最低的分区，用于最先适应
 } Partition;
 
+// 由嵌入的树节点指针得到所在分区的指针
+#define PARTITION_OF(node, member) ((Partition *)((char *)(node) - offsetof(Partition, member)))
+
+// 伙伴系统内存块结构定义
+typedef struct buddy_block {
+    long long start_addr;  // 块起始地址
+    int order;             // 块的阶，块大小为2^order KB
+    int status;            // 块状态：FREE或BUSY
+    long long request_size;  // 进程实际请求的大小(KB)，用于统计内部碎片
+    unsigned int process_id; // 占用该块的进程号，空闲为FREE_PROCESS_ID
+    struct buddy_block *prev;      // 按地址排序的块链表中的前一个块
+    struct buddy_block *next;      // 按地址排序的块链表中的后一个块
+    struct buddy_block *free_prev; // 同阶空闲链表中的前一个空闲块
+    struct buddy_block *free_next; // 同阶空闲链表中的后一个空闲块
+    struct buddy_block *owner_next; // 同一进程占用的块链表中的后一个块
+} BuddyBlock;
+
+// 位图分配引擎中进程占用的一段连续粒度块
+typedef struct bitmap_block {
+    long long start;         // 起始粒度块号，地址为start * bitmap_granule
+    long long count;         // 占用的粒度块数
+    long long request_size;  // 进程实际请求的大小(KB)，用于统计内部碎片
+    unsigned int process_id; // 占用该段的进程号
+    struct bitmap_block *owner_next; // 同一进程占用的块链表中的后一个块
+} BitmapBlock;
+
+// TLSF分配引擎的内存块，按地址顺序链接，分配时按请求大小精确分割
+typedef struct tlsf_block {
+    long long start_addr;    // 块起始地址
+    long long size;          // 块大小(KB)
+    int status;              // 块状态：FREE或BUSY
+    unsigned int process_id; // 占用该块的进程号，空闲为FREE_PROCESS_ID
+    struct tlsf_block *prev;       // 按地址排序的块链表中的前一个块
+    struct tlsf_block *next;       // 按地址排序的块链表中的后一个块
+    struct tlsf_block *free_prev;  // 同一(一级, 二级)空闲链表中的前一个空闲块
+    struct tlsf_block *free_next;  // 同一(一级, 二级)空闲链表中的后一个空闲块
+    struct tlsf_block *owner_next; // 同一进程占用的块链表中的后一个块
+} TlsfBlock;
+
+// 位图的分层摘要：每个节点记录它覆盖的粒度块中开头、末尾和最长的连续空闲块数，
+// 查找时由根节点向下直接找到地址最低的足够长的空闲段；最高一层只有一个根节点
+typedef struct {
+    long long *prefix[BITMAP_MAX_LEVELS];   // 各层节点开头的连续空闲块数
+    long long *suffix[BITMAP_MAX_LEVELS];   // 各层节点末尾的连续空闲块数
+    long long *longest[BITMAP_MAX_LEVELS];  // 各层节点内最长的连续空闲块数
+    long long nodes[BITMAP_MAX_LEVELS];     // 各层的节点数
+    int levels;                             // 层数
+} BitmapSummary;
+
+// 进程索引表项：驻留的进程名及其进程号，同时记录该进程占用的全部分区，按进程名哈希
+// 进程不再占用内存时表项被回收，进程号留给下一个新进程使用
+typedef struct process_entry {
+    char process_name[20];         // 进程名称
+    unsigned int process_id;       // 进程号，从1开始编号，分区中只保存进程号
+    Partition *partitions;         // 该进程在可变分区中占用的分区链表
+    BuddyBlock *buddy_blocks;      // 该进程在伙伴系统中占用的块链表
+    BitmapBlock *bitmap_blocks;    // 该进程在位图分配引擎中占用的块链表
+    TlsfBlock *tlsf_blocks;        // 该进程在TLSF分配引擎中占用的块链表
+    int table_partitions;          // 该进程在数组分区表中占用的分区数
+    struct process_entry *next;    // 同一哈希桶中的下一个表项；回收后为空闲表项链表中的下一个
+} ProcessEntry;
+
 // 资源请求表项结构定义
 typedef struct {
     char process_name[20]; // 请求分配内存的进程名称
-    int size;              // 进程请求的内存大小(KB)
+    long long size;        // 进程请求的内存大小(KB)
 } Request;
 
+// 性能测试负载：预先生成的分配请求，以及每次分配后要释放的进程
+typedef struct {
+    int ops;               // 分配请求数
+    Request *allocs;       // 第t次分配的请求
+    int *release_head;     // 第t次分配后要释放的请求下标链表头，-1表示没有
+    int *release_next;     // 释放链表中的下一个请求下标
+} Workload;
+
+// 批量分配时的排序项：按请求大小排序，同时记住请求的原始位置
+typedef struct {
+    long long size;        // 请求大小(KB)
+    int index;             // 请求在批量数组中的下标
+} BatchItem;
+
+// 内存占用和碎片指标，由增量维护的计数器直接得到，查询不需要遍历分区链表
+typedef struct {
+    long long free_total;    // 空闲总量(KB)
+    long long busy_total;    // 已分配总量(KB)
+    long long hole_count;    // 空闲块个数
+    long long largest_free;  // 最大空闲块大小(KB)
+    long long internal;      // 内部碎片总量(KB)
+    double external;       // 外部碎片率：1 - 最大空闲块 / 空闲总量
+} MemoryMetrics;
+
+// 对数分桶的直方图，用于分配器延迟（计时器周期）和查找访问的节点数
+typedef struct {
+    long long count;                     // 记录次数
+    unsigned long long total;            // 数值总和，用于求平均值
+    unsigned long long max;              // 最大值
+    long long buckets[PROFILE_BUCKETS];  // 各桶的次数
+} Histogram;
+
+// 快照文件头。文件依次存放：文件头、分区记录（按地址顺序）、伙伴系统块记录（按地址顺序）、
+// 位图分配的已分配块记录（按地址顺序）、TLSF块记录（按地址顺序）、进程记录、
+// 空闲分区按(大小, 起始地址)排序的下标、伙伴系统各阶空闲链表中块的下标（从0阶起，链表头在前）、
+// TLSF各(一级, 二级)空闲链表中块的下标（从低级到高级，链表头在前）。
+// 全部是定长记录，记录之间用下标互相引用，恢复时把文件映射到内存后直接按下标读取
+typedef struct {
+    char magic[8];                  // 文件标识SNAPSHOT_MAGIC
+    long long version;              // 格式版本SNAPSHOT_VERSION
+    long long total_memory_size;    // 总内存大小(KB)
+    long long managed_memory;       // 全部内存段的总大小(KB)
+    long long layout_seed;          // 生成初始内存布局所用的随机数种子
+    long long partition_count;      // 分区数
+    long long free_partition_count; // 空闲分区数
+    long long buddy_block_count;    // 伙伴系统块数
+    long long buddy_free_count;     // 伙伴系统空闲块数
+    long long process_count;        // 进程数
+    long long next_fit_rover;       // 循环首次适应游标所指分区的下标，-1表示没有
+    long long bitmap_block_count;   // 位图分配的已分配块数
+    long long tlsf_block_count;     // TLSF块数
+    long long tlsf_free_count;      // TLSF空闲块数
+} SnapshotHeader;
+
+// 快照中的分区记录，进程号为FREE_PROCESS_ID的是空闲分区
+typedef struct {
+    long long start_addr;           // 分区起始地址
+    long long size;                 // 分区大小(KB)
+    unsigned int process_id;        // 快照内的进程号（进程记录的下标+1）
+    unsigned int owner_next;        // 同一进程的下一个分区的下标+1，0表示没有
+} SnapshotPartition;
+
+// 快照中的伙伴系统块记录，进程号为FREE_PROCESS_ID的是空闲块
+typedef struct {
+    long long start_addr;           // 块起始地址
+    long long request_size;         // 进程实际请求的大小(KB)
+    int order;                      // 块的阶
+    unsigned int process_id;        // 快照内的进程号
+    unsigned int owner_next;        // 同一进程的下一个块的下标+1，0表示没有
+    unsigned int reserved;          // 保留，使记录按8字节对齐
+} SnapshotBuddyBlock;
+
+// 快照中的位图分配块记录，位图本身不保存，恢复时由内存段和这些块重新标记
+typedef struct {
+    long long start;                // 起始粒度块号
+    long long count;                // 占用的粒度块数
+    long long request_size;         // 进程实际请求的大小(KB)
+    unsigned int process_id;        // 快照内的进程号
+    unsigned int owner_next;        // 同一进程的下一个块的下标+1，0表示没有
+} SnapshotBitmapBlock;
+
+// 快照中的TLSF块记录，进程号为FREE_PROCESS_ID的是空闲块
+typedef struct {
+    long long start_addr;           // 块起始地址
+    long long size;                 // 块大小(KB)
+    unsigned int process_id;        // 快照内的进程号
+    unsigned int owner_next;        // 同一进程的下一个块的下标+1，0表示没有
+} SnapshotTlsfBlock;
+
+// 快照中的进程记录，进程号按记录顺序从1开始重新编号
+typedef struct {
+    char process_name[20];          // 进程名称
+    unsigned int partitions;        // 该进程分区链表第一个分区的下标+1，0表示没有
+    unsigned int buddy_blocks;      // 该进程伙伴系统块链表第一个块的下标+1，0表示没有
+    unsigned int bitmap_blocks;     // 该进程位图分配块链表第一个块的下标+1，0表示没有
+    unsigned int tlsf_blocks;       // 该进程TLSF块链表第一个块的下标+1，0表示没有
+} SnapshotProcess;
+
+// 二进制轨迹文件头，后面紧跟record_count条定长的TraceRecord
+typedef struct {
+    char magic[8];                  // 文件标识TRACE_MAGIC
+    long long version;              // 格式版本TRACE_VERSION
+    long long record_count;         // 记录数
+    long long process_count;        // 进程数，进程号为1~process_count
+    long long page_count;           // 访问记录的页号范围（0 ~ page_count-1）
+    long long page_size;            // 页面大小（字节），访问记录的页内地址范围
+} TraceHeader;
+
+// 二进制轨迹记录（24字节定长），文件映射到内存后可以按下标直接读取，也可以顺序流式读取
+typedef struct {
+    double time;                    // 事件时间（秒）
+    unsigned int process_id;        // 进程号，对应的进程名为"P"加进程号
+    char type;                      // 记录类型：TRACE_ALLOC/TRACE_FREE/TRACE_ACCESS
+    char operation;                 // 访问记录的操作类型，与Instruction.operation相同，'s'表示写
+    unsigned short reserved;        // 保留，为0
+    union {
+        long long size;             // 分配记录：请求大小(KB)
+        struct {
+            int page_number;        // 访问记录：页号
+            int offset;             // 访问记录：页内地址
+        } access;
+    } data;
+} TraceRecord;
+
+// 轨迹读取器：文本轨迹逐行读取，二进制轨迹映射到内存后顺序读取
+typedef struct {
+    FILE *fp;                       // 文本轨迹文件，二进制轨迹为NULL
+    long long line_number;          // 文本轨迹当前的行号
+    HANDLE file;                    // 二进制轨迹的文件句柄
+    HANDLE mapping;                 // 二进制轨迹的文件映射句柄
+    const TraceHeader *header;      // 映射到内存的二进制轨迹文件头
+    const TraceRecord *records;     // 映射到内存的二进制轨迹记录
+    long long next;                 // 下一条要读取的记录下标
+    long long skipped;              // 跳过的页面访问记录数
+} TraceReader;
+
+// 合成负载生成器的参数
+typedef struct {
+    long long processes;            // 进程数，每个进程分配一次、到期后释放
+    double arrival_rate;            // 进程到达率（每秒），到达间隔服从指数分布（泊松到达）
+    int size_distribution;          // 请求大小分布（DIST_*）
+    long long mean_size;            // 平均请求大小(KB)
+    int lifetime_distribution;      // 存活时间分布（DIST_*）
+    double mean_lifetime;           // 平均存活时间，以到达间隔为单位（秒数 = mean_lifetime / arrival_rate）
+    int refs_per_arrival;           // 每次到达后随机选一个存活进程连续访问的页面数，0表示不生成访问记录
+    int locality;                   // 局部性模型（LOCALITY_*），LOCALITY_MIXED表示每个进程随机选择
+    int page_count;                 // 页号范围
+    int page_size;                  // 页面大小（字节）
+    unsigned long long seed;        // 随机数种子
+} GeneratorSpec;
+
+// 生成器中一个进程的页面访问状态
+typedef struct {
+    int locality;                   // 局部性模型
+    int base;                       // 进程页面的起始页号
+    int pages;                      // 进程的页面数
+    int window;                     // 工作集窗口在进程页面中的起始位置
+    int cursor;                     // 循环和顺序扫描模型的当前位置
+} GeneratorProcess;
+
+// 生成器中等待释放的进程，按释放时间组成最小堆
+typedef struct {
+    double time;                    // 释放时间（秒）
+    unsigned int process_id;        // 进程号
+} PendingFree;
+
 // 全局变量定义
+NodePool partition_pool = {sizeof(Partition), NULL, NULL, NULL, 0};    // 分区节点池
+NodePool buddy_pool = {sizeof(BuddyBlock), NULL, NULL, NULL, 0};       // 伙伴系统块节点池
 Partition *memory_list = NULL;  // 内存分区链表头指针
-int total_memory_size = 1024;   // 总内存大小，默认为1024KB
+long long total_memory_size = 1024;  // 总内存大小，默认为1024KB
 int algorithm = FIRST_FIT;      // 当前使用的内存分配算法，默认为最先适应算法
+Partition *free_lists[SIZE_CLASS_COUNT];  // 按2的幂大小分级的空闲分区链表，只包含空闲分区
+TreeNode *size_tree = NULL;     // 空闲分区按(大小, 起始地址)排序的平衡树根节点
+TreeNode *addr_tree = NULL;     // 全部分区（含已分配的）按起始地址排序的平衡树根节点
+Partition *next_fit_rover = NULL;  // 循环首次适应算法的游标：下次查找的起始分区
+long long managed_memory = 0;   // 全部内存段的总大小(KB)，不含段间间隙
+long long free_memory = 0;      // 空闲分区索引中的空闲总量(KB)
+long long free_partition_count = 0;  // 空闲分区索引中的分区数
+Partition *largest_free_partition = NULL;  // 平衡树中最大的空闲分区，即最右节点
+BuddyBlock *buddy_list = NULL;  // 伙伴系统按地址排序的块链表头指针
+BuddyBlock *buddy_free_lists[BUDDY_ORDER_COUNT];  // 伙伴系统各阶的空闲块链表
+long long buddy_free_memory = 0;  // 伙伴系统空闲块的总大小(KB)
+long long buddy_free_count = 0;   // 伙伴系统空闲块数
+long long buddy_internal = 0;     // 伙伴系统已分配块中未被请求使用的总量(KB)
+NodePool bitmap_pool = {sizeof(BitmapBlock), NULL, NULL, NULL, 0};     // 位图分配引擎的块节点池
+long long bitmap_granule = 1;     // 位图的粒度(KB)，请求大小向上取整到粒度的倍数
+long long bitmap_granules = 0;    // 位图覆盖的粒度块数（从地址0到最后一个内存段末尾）
+long long bitmap_words = 0;       // 粒度位图的字数
+unsigned long long *bitmap_free_bits = NULL;  // 粒度位图：每位对应一个粒度块，1表示空闲
+BitmapSummary bitmap_summary;     // 粒度位图的分层摘要
+long long bitmap_free_granules = 0;  // 空闲粒度块数
+long long bitmap_hole_count = 0;  // 连续空闲段的个数
+long long bitmap_internal = 0;    // 已分配块中未被请求使用的总量(KB)
+NodePool tlsf_pool = {sizeof(TlsfBlock), NULL, NULL, NULL, 0};         // TLSF分配引擎的块节点池
+TlsfBlock *tlsf_list = NULL;      // TLSF按地址排序的块链表头指针
+TlsfBlock *tlsf_free_lists[TLSF_FL_COUNT][TLSF_SL_COUNT];  // TLSF各(一级, 二级)的空闲块链表
+unsigned long long tlsf_fl_bitmap = 0;       // 第i位为1表示第i个一级中有非空的空闲链表
+unsigned int tlsf_sl_bitmap[TLSF_FL_COUNT];  // 第i个一级中第j位为1表示(i, j)空闲链表非空
+long long tlsf_free_memory = 0;   // TLSF空闲块的总大小(KB)
+long long tlsf_free_count = 0;    // TLSF空闲块数
+TlsfBlock *tlsf_largest_free = NULL;  // TLSF最大的空闲块；还有空闲块时为NULL表示已失效，查询指标时再重新查找
+int compaction_enabled = 0;     // 分配失败时是否自动紧凑内存后重试
+int compaction_count = 0;       // 紧凑的次数
+long long compaction_moved = 0; // 紧凑时移动的数据总量(KB)
+double compaction_seconds = 0;  // 紧凑花费的总时间（秒）
+long long realloc_moved = 0;   // 调整大小时无法原地扩大而搬移的数据总量(KB)
+int front_cache_enabled = 0;    // 是否启用前端缓存：释放的小分区先暂存，留给下一个同样大小的请求
+Partition *front_cache_bins[FRONT_CACHE_MAX_SIZE + 1];  // 按分区大小(KB)分桶暂存的分区，后进先出
+int front_cache_bin_count[FRONT_CACHE_MAX_SIZE + 1];    // 各缓存桶中的分区数
+long long front_cache_memory = 0;  // 前端缓存中暂存的分区总大小(KB)
+long long front_cache_hits = 0;    // 直接由前端缓存满足的请求数
+long long front_cache_misses = 0;  // 大小在缓存范围内但缓存中没有可用分区的请求数
+int front_cache_flushes = 0;       // 清空前端缓存的次数
+int lazy_coalesce_enabled = 0;     // 是否延迟合并：释放时只标记为空闲，之后批量扫描合并
+int lazy_coalesce_threshold = LAZY_COALESCE_THRESHOLD;  // 未合并的释放累计到该次数时做一次合并扫描
+int lazy_dirty_frees = 0;          // 上次合并扫描之后未合并的释放次数
+int lazy_sweeps = 0;               // 延迟合并做过的合并扫描次数
+ProcessEntry **process_table = NULL;  // 进程名到所占分区的哈希表
+int process_table_size = 0;     // 哈希表桶数
+int process_count = 0;          // 哈希表中的进程数
+ProcessEntry **process_by_id = NULL;  // 按进程号直接索引的表项（含已回收的），下标0不用
+int process_by_id_capacity = 0; // process_by_id数组的容量
+int process_id_count = 0;       // 已分配的进程号数，即最大的进程号
+ProcessEntry *free_process_entries = NULL;  // 回收的表项，复用其内存和进程号
+TableChunk *partition_table = NULL;  // 数组分区表的第一块（另一种分区存储方式，与链表互相独立）
+FitKernels fit_kernels = {NULL, NULL, NULL, NULL};  // 数组分区表当前使用的查找内核，首次建表时按CPU选择
+unsigned int layout_seed = 0;   // 最近一次生成初始内存布局所用的随机数种子
+int layout_seed_fixed = 0;      // 是否指定了固定的布局种子（--seed），否则按当前时间生成
+const char *start_snapshot = NULL;  // 轨迹回放和负载测试的初始状态快照文件，NULL表示按种子生成布局
+#ifdef ALLOC_PROFILE
+Histogram profile_latency[PROFILE_OP_COUNT][TLSF_SYSTEM + 1];  // 各操作在各算法下每次调用的耗时（计时器周期），第二维下标为算法标识
+Histogram profile_visits[TLSF_SYSTEM + 1];  // 各算法每次查找访问的空闲分区、链表节点或平衡树节点数
+long long profile_nodes_visited = 0;        // 当前这次查找已访问的节点数
+double profile_ticks_per_ns = 0;            // 计时器每纳秒的周期数，首次输出时校准
+#endif
 
 // 函数声明
 void initialize_memory();                  // 初始化内存
+void build_memory_segments(unsigned int seed);  // 按种子创建不连续的内存分区
+unsigned long long xorshift_next(unsigned long long *state);  // 64位xorshift*随机数生成器前进一步
 void display_memory();                     // 显示内存使用情况
-int allocate_memory(Request req);          // 分配内存
+int allocate_memory(Request req, long long alignment);  // 分配内存，起始地址按alignment对齐
+int realloc_memory(const char *process_name, long long new_size);  // 调整进程最近分配的分区大小，尽量原地调整
+int allocate_batch(Request *reqs, int n, int *results);  // 批量分配内存
+void sort_batch_items(BatchItem *items, int n);  // 把批量请求按大小从大到小排序
+Partition* find_free_partition(long long size);  // 按当前算法查找合适的空闲分区
+Partition* find_aligned_partition(long long size, long long alignment);  // 查找能放下按alignment对齐的请求的空闲分区
+Partition* split_free_partition(Partition *p, long long head_size);  // 把空闲分区分成前后两个空闲分区
+long long align_up(long long addr, long long alignment);  // 把地址向上对齐到alignment的倍数
+long long free_memory_total();             // 统计空闲内存总量
+int front_cache_take(Request req, long long alignment);  // 从前端缓存中取出同样大小的分区分配给请求
+int front_cache_park(Partition *p);        // 把刚释放的分区暂存到前端缓存中
+void front_cache_flush();                  // 清空前端缓存，暂存的分区合并回空闲分区索引
+void benchmark_front_cache();              // 比较启用前端缓存前后的吞吐量、命中率和碎片
+void lazy_coalesce_sweep();                // 延迟合并：扫描一遍分区链表，合并所有相邻的空闲分区
+void benchmark_lazy_coalesce();            // 比较立即合并与延迟合并的吞吐量和碎片
+int allocate_by_policy(Request req, long long alignment);  // 按当前算法分配内存（allocate_memory去掉计时的部分）
+int release_by_policy(char *process_name); // 按当前算法释放进程的内存（release_memory去掉计时的部分）
+#ifdef ALLOC_PROFILE
+unsigned long long profile_ticks();        // 读取计时器周期数
+unsigned long long profile_begin();        // 开始一次计时，清零查找访问的节点数
+void profile_record(int op, unsigned long long ticks);  // 把一次调用的耗时记入当前算法的直方图
+int histogram_bucket(unsigned long long value);  // 计算数值所在的直方图桶
+unsigned long long histogram_bucket_upper(int bucket);  // 求直方图桶中最大的数值
+void histogram_add(Histogram *h, unsigned long long value);  // 向直方图中加入一个数值
+unsigned long long histogram_percentile(const Histogram *h, double q);  // 求直方图的分位数
+void profile_reset();                      // 清空全部延迟直方图
+double profile_ticks_to_ns(unsigned long long ticks);  // 把计时器周期换算为纳秒
+void profile_report();                     // 输出各操作、各算法的延迟分位数和查找访问的节点数
+void benchmark_profile();                  // 比较各算法的延迟分布和查找访问的节点数随内存大小的变化
+#endif
+void compact_memory();                     // 紧凑内存：把已分配分区移向各连续段的低地址端
 int release_memory(char *process_name);    // 释放内存
-Partition* first_fit(int size);            // 最先适应算法
-Partition* best_fit(int size);             // 最佳适应算法
-Partition* worst_fit(int size);            // 最坏适应算法
+int release_at(long long addr);            // 释放从指定地址开始的已分配分区
+Partition* lookup_address(long long addr); // 查找包含指定地址的分区
+void release_partition(Partition *p);      // 把已从进程分区链表中摘下的分区变为空闲并合并
+Partition* first_fit(long long size);      // 最先适应算法
+Partition* best_fit(long long size);       // 最佳适应算法
+Partition* worst_fit(long long size);      // 最坏适应算法
+Partition* next_fit(long long size);       // 循环首次适应算法
+const char* algorithm_name(int alg);       // 获取分配算法的中文名称
 void merge_free_partitions();              // 合并相邻空闲分区
+int can_merge(Partition *a, Partition *b); // 判断两个相邻分区能否合并
+void merge_with_next(Partition *p);        // 把下一个分区并入当前分区
+void absorb_next(Partition *p);            // 把下一个分区并入当前分区，不更新当前分区的空闲索引
+Partition* coalesce_partition(Partition *p);  // 空闲分区与地址相邻的空闲分区合并
+int size_class(long long size);            // 计算分区大小所属的分级
+void free_list_insert(Partition *p);       // 将空闲分区加入分级空闲链表
+void free_list_remove(Partition *p);       // 将分区从分级空闲链表中移除
+void free_index_insert(Partition *p);      // 将空闲分区加入所有空闲分区索引
+void free_index_remove(Partition *p);      // 将分区从所有空闲分区索引中移除
+void clear_memory_list();                  // 释放全部分区节点并清空索引
+void* pool_alloc(NodePool *pool);          // 从节点池中取一个节点
+void pool_free(NodePool *pool, void *node);    // 把节点还给节点池
+void pool_release_all(NodePool *pool);     // 一次性释放节点池的全部内存
+TreeNode* tree_insert(TreeNode *root, TreeNode *node, int (*cmp)(TreeNode *, TreeNode *), void (*update)(TreeNode *));  // 平衡树插入
+TreeNode* tree_remove(TreeNode *root, TreeNode *node, int (*cmp)(TreeNode *, TreeNode *), void (*update)(TreeNode *));  // 平衡树删除
+TreeNode* tree_build_sorted(TreeNode **nodes, long long n, void (*update)(TreeNode *));  // 由已排序的节点在O(n)时间内建立平衡树
+int compare_by_size(TreeNode *a, TreeNode *b);  // 按(大小, 起始地址)比较两个空闲分区
+void size_tree_update(TreeNode *n);        // 重新计算空闲分区平衡树节点所在子树中地址最低的分区
+Partition* size_tree_lower_bound(long long size);  // 查找大小不小于size的最小空闲分区
+int compare_by_addr(TreeNode *a, TreeNode *b);  // 按起始地址比较两个分区
+void addr_index_insert(Partition *p);      // 将分区加入地址索引
+void addr_index_remove(Partition *p);      // 将分区从地址索引中移除
+TreeNode* addr_tree_build(Partition **cursor, long long n);  // 由按地址排序的分区链表建立平衡树
+void addr_index_rebuild();                 // 按分区链表在O(n)时间内重建地址索引
+double get_time_seconds();                 // 获取高精度计时器时间
+int run_command_line(int argc, char *argv[]);   // 处理命令行参数，以非交互方式运行
+void print_usage(const char *program);     // 打印命令行用法
+int parse_algorithm(const char *text);     // 把算法名称或编号解析为算法标识
+int replay_trace(const char *path, unsigned int seed, const char *save_path);  // 无交互地回放分配/释放轨迹文件
+int trace_open(TraceReader *r, const char *path);  // 打开文本或二进制轨迹文件
+int trace_next(TraceReader *r, double *timestamp, Request *req);  // 读取下一个分配或释放事件
+void trace_close(TraceReader *r);          // 关闭轨迹文件
+int parse_distribution(const char *text);  // 把分布名称解析为分布类型
+int parse_locality(const char *text);      // 把局部性模型名称解析为模型类型
+double sample_distribution(int distribution, double mean);  // 按指定分布生成一个随机数
+int generate_trace(const char *path, const GeneratorSpec *spec);  // 生成合成负载并写成二进制轨迹文件
+void generate_access(GeneratorProcess *p, int page_size, TraceRecord *rec);  // 按进程的局部性模型生成一次页面访问
+void pending_sift_up(PendingFree *heap, long long i);  // 把最小堆中的元素向上调整
+PendingFree pending_pop(PendingFree *heap, long long *count);  // 取出释放时间最早的进程
+void benchmark_suite(int distribution, int ops, int mean_lifetime, long long mean_size);  // 多种负载分布下的分配算法测试
+void benchmark_table();                    // 比较数组分区表与链表的查找和分配性能
+void table_build();                        // 按当前分区链表创建数组分区表
+void select_fit_kernels();                 // 按CPU支持的指令集选择查找内核
+int available_fit_kernels(FitKernels *kernels);  // 列出当前CPU可用的全部查找内核
+void benchmark_simd();                     // 测试各指令集查找内核的速度
+void table_clear();                        // 释放数组分区表
+int table_allocate(Request req);           // 在数组分区表中分配内存
+int table_release(const char *process_name);  // 在数组分区表中释放进程的全部内存
+void benchmark_fit_lookup();               // 测试最佳/最坏适应查找延迟随分区数的变化
+void benchmark_policies();                 // 在同一负载下比较各分配算法的吞吐量和碎片
+void benchmark_batch();                    // 比较批量分配与逐个分配的接纳率和碎片
+void buddy_initialize();                   // 按当前内存分区布局初始化伙伴系统
+void buddy_clear();                        // 释放伙伴系统的全部块
+int buddy_allocate(Request req, long long alignment);  // 伙伴系统分配内存
+int buddy_realloc(const char *process_name, long long new_size);  // 伙伴系统调整进程最近分配的块的大小
+int buddy_release(char *process_name);     // 伙伴系统释放内存
+void display_buddy_memory();               // 显示伙伴系统内存使用情况
+void bitmap_initialize();                  // 按当前内存分区布局初始化位图分配引擎
+void bitmap_clear();                       // 释放位图分配引擎的全部块和位图
+int bitmap_allocate(Request req, long long alignment);  // 位图分配引擎分配内存
+int bitmap_release(char *process_name);    // 位图分配引擎释放内存
+int bitmap_realloc(const char *process_name, long long new_size);  // 位图分配引擎调整进程最近分配的块的大小
+long long bitmap_find_run(long long count);  // 查找地址最低的足够长的连续空闲粒度块
+long long bitmap_granule_for(long long span);  // 计算覆盖span(KB)内存所用的粒度大小
+void display_bitmap_memory();              // 显示位图分配引擎的内存使用情况
+void tlsf_initialize();                    // 按当前内存分区布局初始化TLSF分配引擎
+void tlsf_clear();                         // 释放TLSF分配引擎的全部块
+int tlsf_allocate(Request req, long long alignment);  // TLSF分配引擎分配内存
+int tlsf_release(char *process_name);      // TLSF分配引擎释放内存
+int tlsf_realloc(const char *process_name, long long new_size);  // TLSF分配引擎调整进程最近分配的块的大小
+TlsfBlock* tlsf_find_block(long long size);  // 由一级/二级位图在O(1)时间内找到足够大的空闲块
+TlsfBlock* tlsf_find_largest();            // 在最高的非空空闲链表中查找最大的空闲块
+void display_tlsf_memory();                // 显示TLSF分配引擎的内存使用情况
+void display_fragmentation();              // 显示内部碎片和外部碎片统计
+void query_metrics(MemoryMetrics *m);      // O(1)查询当前分配引擎的占用和碎片指标
+int save_snapshot(const char *path);       // 把分区链表、伙伴系统和各项索引保存为二进制快照
+int load_snapshot(const char *path);       // 映射快照文件并一次恢复全部分配器状态
+int restore_snapshot(const char *data, long long length);  // 由内存中的快照内容恢复分配器状态
+void benchmark_snapshot();                 // 测试快照的保存/恢复耗时，并验证恢复后的行为与原状态一致
+double external_fragmentation(long long free_total, long long largest_free);  // 计算外部碎片率
+ProcessEntry* process_lookup(const char *process_name, int create);  // 按进程名查找进程索引表项
+void process_attach(Partition *p);         // 把已分配分区挂到所属进程的分区链表上
+unsigned int intern_process(const char *process_name);  // 驻留进程名，返回进程号
+void process_remove_if_empty(ProcessEntry *e);  // 进程不再占用内存时回收其表项
+const char* process_name_of(unsigned int process_id);  // 由进程号得到进程名，只在显示时使用
+void process_table_clear();                // 清空进程索引
 void print_menu();                         // 打印菜单
 void clear_screen();                       // 清屏
 void set_text_color(int color);            // 设置文本颜色
@@ -57,16 +648,28 @@ void set_console_charset();                // 设置控制台字符集
 /**
  * 主函数：程序入口点，实现用户交互和功能调用
  */
-int main() {
+int main(int argc, char *argv[]) {
     int choice, ret;           // choice存储用户选择，ret存储函数返回结果
     Request req;               // 内存请求结构
     char process_name[20];     // 进程名称缓冲区
+    char snapshot_path[260];   // 快照文件名缓冲区
+    long long size;            // 对齐大小或调整后的大小(KB)
     
     // 设置控制台字符集，解决中文显示问题
     set_console_charset();
     
-    // 初始化内存分区链表
-    initialize_memory();
+    // 带命令行参数时以非交互方式运行（如性能测试）
+    if (argc > 1) {
+        ret = run_command_line(argc, argv);
+        if (ret >= 0) {
+            return ret;
+        }
+    }
+    
+    // 初始化内存分区链表（命令行已加载快照时直接使用快照中的状态）
+    if (!memory_list) {
+        initialize_memory();
+    }
     
     // 主循环，实现用户交互
     while (1) {
@@ -84,17 +687,19 @@ int main() {
                 printf("请输入进程名: ");
                 scanf("%s", req.process_name);     // 读取进程名
                 printf("请输入所需内存大小(KB): ");
-                scanf("%d", &req.size);            // 读取请求内存大小
+                scanf("%lld", &req.size);            // 读取请求内存大小
+                printf("请输入起始地址对齐大小(KB，2的幂，1表示不对齐): ");
+                scanf("%lld", &size);                // 读取对齐大小
                 
                 // 调用内存分配函数并处理结果
-                ret = allocate_memory(req);//调用 allocate_memory 函数尝试分配内存。req 是请求的内存大小（通常是一个整数，表示所需内存的字节数）
+                ret = allocate_memory(req, size);//调用 allocate_memory 函数尝试分配内存。req 是请求的内存大小（通常是一个整数，表示所需内存的字节数）
                 if (ret) { //检查 ret 的值以确定内存分配是否成功。如果 ret 不为 NULL（即非零），则表示内存分配成功
                     set_text_color(10); // 绿色，表示成功
                     printf("内存分配成功!\n");
                     reset_text_color(); //调用 reset_text_color 函数，重置文本颜色到默认值。这通常是在输出成功消息后，确保后续的输出不会继续使用绿色
                 } else {
                     set_text_color(12); // 红色，表示失败
-                    printf("内存分配失败，没有足够的空间!\n");
+                    printf("内存分配失败，没有足够的空间或对齐大小不是2的幂!\n");
                     reset_text_color();
                 }
                 display_memory();  // 显示分配后的内存情况
@@ -119,36 +724,165 @@ int main() {
                 break;
                 
             case 4: // 切换内存分配算法
-                printf("请选择分配算法 (1-最先适应, 2-最佳适应, 3-最坏适应): ");
+                printf("请选择分配算法 (1-最先适应, 2-最佳适应, 3-最坏适应, 4-循环首次适应, 5-伙伴系统, 6-位图分配, 7-TLSF): ");
                 scanf("%d", &algorithm);
                 // 验证算法选择是否有效 使用 scanf 函数从标准输入读取用户输入的分配算法编号，并将其存储在 algorithm 变量中。%d 格式说明符表示读取一个整数
-                if (algorithm < 1 || algorithm > 3) {
+                if (algorithm < 1 || algorithm > 7) {
                     algorithm = FIRST_FIT;  // 无效选择，默认为最先适应算法 检查用户输入的算法选择是否有效
                 }
                 
                 // 显示当前使用的算法
-                if (algorithm == FIRST_FIT) {
-                    printf("当前使用算法: 最先适应\n");
-                } else if (algorithm == BEST_FIT) {
-                    printf("当前使用算法: 最佳适应\n");
-                } else {
-                    printf("当前使用算法: 最坏适应\n");
-                }
+                printf("当前使用算法: %s\n", algorithm_name(algorithm));
                 break;
                 
             case 5: // 重置内存
                 printf("正在重置内存...\n");
-                // free(memory_list);        // 释放当前内存链表     调用 free 函数释放 memory_list 指向的内存链表。这是为了释放之前分配的内存，避免内存泄漏。
                 initialize_memory();      // 重新初始化内存       这通常意味着将内存状态重置为初始状态，准备好进行新的内存分配。
                 printf("内存已重置.\n");
                 display_memory();         // 显示重置后的内存情况
                 break;
                 
             case 6: // 退出程序
-                free(memory_list);        // 释放内存链表，避免内存泄漏
+                clear_memory_list();      // 释放全部分区节点，避免内存泄漏
                 printf("程序已退出.\n");
                 exit(0);                  // 正常退出程序
                 
+            case 7: // 紧凑设置
+                if (algorithm == BUDDY_SYSTEM || algorithm == BITMAP_SYSTEM || algorithm == TLSF_SYSTEM) {
+                    printf("%s不支持紧凑.\n", algorithm_name(algorithm));
+                    break;
+                }
+                printf("分配失败时自动紧凑: %s\n", compaction_enabled ? "开启" : "关闭");
+                printf("请选择 (1-开启自动紧凑, 2-关闭自动紧凑, 3-立即紧凑): ");
+                scanf("%d", &ret);
+                if (ret == 1 || ret == 2) {
+                    compaction_enabled = (ret == 1);
+                } else if (ret == 3) {
+                    compact_memory();
+                }
+                printf("紧凑次数: %d  移动数据: %lldKB  耗时: %.3fms\n",
+                       compaction_count, compaction_moved, compaction_seconds * 1000);
+                display_memory();         // 显示紧凑后的内存情况
+                break;
+                
+            case 8: // 保存/加载快照
+                printf("请选择 (1-保存快照, 2-加载快照): ");
+                scanf("%d", &ret);
+                if (ret != 1 && ret != 2) {
+                    printf("无效选择.\n");
+                    break;
+                }
+                printf("请输入快照文件名: ");
+                scanf("%259s", snapshot_path);
+                if (ret == 1) {
+                    if (save_snapshot(snapshot_path)) {
+                        printf("快照已保存.\n");
+                    }
+                } else if (load_snapshot(snapshot_path)) {
+                    printf("快照已加载.\n");
+                    display_memory();     // 显示加载后的内存情况
+                } else if (!memory_list) {
+                    initialize_memory();  // 加载中途失败时原状态已丢弃，重新初始化
+                }
+                break;
+                
+            case 9: // 调整进程内存大小
+                printf("请输入进程名: ");
+                scanf("%s", process_name);
+                printf("请输入新的内存大小(KB): ");
+                scanf("%lld", &size);
+                if (realloc_memory(process_name, size)) {
+                    set_text_color(10); // 绿色，表示成功
+                    printf("内存大小调整成功!\n");
+                } else {
+                    set_text_color(12); // 红色，表示失败
+                    printf("调整失败，未找到该进程或没有足够的空间!\n");
+                }
+                reset_text_color();
+                printf("无法原地扩大而搬移的数据: %lldKB\n", realloc_moved);
+                display_memory();  // 显示调整后的内存情况
+                break;
+                
+            case 10: // 前端缓存设置
+                if (algorithm >= BUDDY_SYSTEM) {
+                    printf("%s不使用前端缓存.\n", algorithm_name(algorithm));
+                    break;
+                }
+                printf("前端缓存: %s\n", front_cache_enabled ? "开启" : "关闭");
+                printf("请选择 (1-开启, 2-关闭并清空, 3-立即清空): ");
+                scanf("%d", &ret);
+                if (ret == 1) {
+                    front_cache_enabled = 1;
+                } else if (ret == 2 || ret == 3) {
+                    front_cache_enabled = front_cache_enabled && ret == 3;
+                    front_cache_flush();
+                }
+                printf("暂存: %lldKB  命中: %lld  未命中: %lld  清空次数: %d\n",
+                       front_cache_memory, front_cache_hits, front_cache_misses, front_cache_flushes);
+                display_memory();         // 显示设置后的内存情况
+                break;
+                
+            case 11: // 按地址查询/释放
+                if (algorithm >= BUDDY_SYSTEM) {
+                    printf("%s不支持按地址查询.\n", algorithm_name(algorithm));
+                    break;
+                }
+                printf("请选择 (1-查询地址所在分区, 2-释放从该地址开始的分区): ");
+                scanf("%d", &ret);
+                printf("请输入地址(KB): ");
+                scanf("%lld", &size);
+                if (ret == 1) {
+                    Partition *p = lookup_address(size);
+                    if (p) {
+                        printf("地址%lld位于分区[%lld, %lld)，大小%lldKB，%s，进程名: %s\n",
+                               size, p->start_addr, p->start_addr + p->size, p->size,
+                               p->status == FREE ? "空闲" : (p->status == CACHED ? "缓存" : "已分配"),
+                               process_name_of(p->process_id));
+                    } else {
+                        printf("地址%lld不在任何内存段内.\n", size);
+                    }
+                } else if (ret == 2) {
+                    if (release_at(size)) {
+                        set_text_color(10); // 绿色，表示成功
+                        printf("内存释放成功!\n");
+                    } else {
+                        set_text_color(12); // 红色，表示失败
+                        printf("该地址不是已分配分区的起始地址!\n");
+                    }
+                    reset_text_color();
+                    display_memory();     // 显示释放后的内存情况
+                } else {
+                    printf("无效选择.\n");
+                }
+                break;
+                
+            case 12: // 延迟合并设置
+                if (algorithm >= BUDDY_SYSTEM) {
+                    printf("%s不使用延迟合并.\n", algorithm_name(algorithm));
+                    break;
+                }
+                printf("延迟合并: %s，扫描阈值: %d次释放\n",
+                       lazy_coalesce_enabled ? "开启" : "关闭", lazy_coalesce_threshold);
+                printf("请选择 (1-开启, 2-关闭并合并, 3-立即合并, 4-设置扫描阈值): ");
+                scanf("%d", &ret);
+                if (ret == 1) {
+                    lazy_coalesce_enabled = 1;
+                } else if (ret == 2 || ret == 3) {
+                    lazy_coalesce_enabled = lazy_coalesce_enabled && ret == 3;
+                    lazy_coalesce_sweep();
+                } else if (ret == 4) {
+                    printf("请输入扫描阈值(次): ");
+                    scanf("%d", &ret);
+                    if (ret > 0) {
+                        lazy_coalesce_threshold = ret;
+                    } else {
+                        printf("无效的阈值.\n");
+                    }
+                }
+                printf("未合并的释放: %d  合并扫描次数: %d\n", lazy_dirty_frees, lazy_sweeps);
+                display_memory();         // 显示设置后的内存情况
+                break;
+                
             default:  // 处理无效输入
                 printf("无效选择，请重新输入.\n");
         }
@@ -199,44 +933,49 @@ void set_console_charset() {
  * 初始化内存，创建多个不连续空闲分区
  */
 void initialize_memory() {
+    // 初始化随机数生成器
+    // 没有指定固定种子时每次按当前时间重新选取，种子记录下来，用--seed即可重现同样的布局
+    if (!layout_seed_fixed) {
+        layout_seed = (unsigned int)time(NULL);
+    }
+    
+    build_memory_segments(layout_seed);
+}
+
+/**
+ * 按种子创建多个不连续空闲分区，并让伙伴系统、位图分配和TLSF使用同样的布局
+ * 随机数取自64位的xorshift*生成器而不是rand()：分区大小的变化和间隙在TB级内存上也能覆盖整个范围
+ * （rand()在Windows上最大只有32767），同一种子在不同的C运行库上也得到相同的布局
+ * @param seed 布局种子，相同的种子得到相同的内存布局
+ */
+void build_memory_segments(unsigned int seed) {
+    unsigned long long random_state = 0x9E3779B97F4A7C15ULL + seed;  // 布局随机数生成器的状态，不为0
     Partition *last = NULL;
     Partition *new_partition = NULL;
     int segments = 4; // 创建的内存分区数量
-    int available_memory = total_memory_size * 3 / 4; // 可用内存总量(总内存的75%)
-    int segment_size = available_memory / segments; // 每个分区的基本大小
-    int current_addr = 0; // 当前地址指针
-    
-    // 初始化随机数生成器
-    // 不使用静态变量，每次都重新初始化
-    srand((unsigned int)time(NULL));
+    long long available_memory = total_memory_size * 3 / 4; // 可用内存总量(总内存的75%)
+    long long segment_size = available_memory / segments; // 每个分区的基本大小
+    long long current_addr = 0; // 当前地址指针
     
     // 安全释放可能存在的旧内存链表
-    Partition *p = memory_list;
-    Partition *temp = NULL;
-    
-    while (p != NULL) {
-        temp = p->next;  // 保存下一个节点
-        free(p);         // 释放当前节点
-        p = temp;        // 移动到下一个节点
-    }
-    memory_list = NULL;  // 重置链表头
+    clear_memory_list();
     
     // 创建多个不连续的内存分区
     for (int i = 0; i < segments; i++) {
         // 分配新分区结构体
-        new_partition = (Partition *)malloc(sizeof(Partition));
+        new_partition = (Partition *)pool_alloc(&partition_pool);
         if (!new_partition) {
             printf("内存分配失败！\n");
             exit(1);
         }
         
         // 设置分区大小(增加一些随机性，但限制范围防止异常)
-        int size_variation = segment_size / 10; // 减小变化范围为基本大小的±10%
-        int actual_size = segment_size;
+        long long size_variation = segment_size / 10; // 减小变化范围为基本大小的±10%
+        long long actual_size = segment_size;
         
         // 确保size_variation不为0，防止除以0错误
         if (size_variation > 0) {
-            actual_size += (rand() % (2 * size_variation + 1) - size_variation);
+            actual_size += (long long)(xorshift_next(&random_state) % (unsigned long long)(2 * size_variation + 1)) - size_variation;
         }
         
         // 确保大小为正数
@@ -248,8 +987,9 @@ void initialize_memory() {
         new_partition->start_addr = current_addr;
         new_partition->size = actual_size;
         new_partition->status = FREE;
-        strcpy(new_partition->process_name, "空闲");
+        new_partition->process_id = FREE_PROCESS_ID;
         new_partition->next = NULL;
+        new_partition->prev = last;
         
         // 维护链表结构
         if (last) {
@@ -258,17 +998,20 @@ void initialize_memory() {
             memory_list = new_partition; // 设置链表头
         }
         last = new_partition;
+        free_index_insert(new_partition); // 加入空闲分区索引
+        addr_index_insert(new_partition); // 加入地址索引
+        managed_memory += actual_size;
         
         // 更新地址指针，添加间隙使得内存不连续
-        int gap = 0;
+        long long gap = 0;
         if (segment_size > 4) {  // 确保有足够空间生成间隙
-            gap = 1 + (rand() % (segment_size / 4));  // 限制间隙大小，防止过大
+            gap = 1 + (long long)(xorshift_next(&random_state) % (unsigned long long)(segment_size / 4));  // 限制间隙大小，防止过大
         }
         current_addr += actual_size + gap;
     }
     
     // 添加一个较大的内存块在末尾
-    new_partition = (Partition *)malloc(sizeof(Partition));
+    new_partition = (Partition *)pool_alloc(&partition_pool);
     if (!new_partition) {
         printf("内存分配失败！\n");
         exit(1);
@@ -277,14 +1020,115 @@ void initialize_memory() {
     new_partition->start_addr = current_addr;
     new_partition->size = total_memory_size / 4; // 最后一个分区占总内存的25%
     new_partition->status = FREE;
-    strcpy(new_partition->process_name, "空闲");
+    new_partition->process_id = FREE_PROCESS_ID;
     new_partition->next = NULL;
+    new_partition->prev = last;
     
     if (last) {
         last->next = new_partition;
     } else {
         memory_list = new_partition;
     }
+    free_index_insert(new_partition);
+    addr_index_insert(new_partition);
+    managed_memory += new_partition->size;
+    
+    // 伙伴系统、位图分配和TLSF使用独立的内存空间，但初始布局与可变分区相同，便于比较
+    buddy_initialize();
+    bitmap_initialize();
+    tlsf_initialize();
+}
+
+/**
+ * 释放全部分区节点，并清空所有空闲分区索引
+ */
+void clear_memory_list() {
+    pool_release_all(&partition_pool);  // 全部分区节点都在节点池中，一次性释放
+    memory_list = NULL;  // 重置链表头
+    next_fit_rover = NULL; // 游标指向的节点已被释放
+    
+    // 清空分级空闲链表和平衡树
+    for (int i = 0; i < SIZE_CLASS_COUNT; i++) {
+        free_lists[i] = NULL;
+    }
+    size_tree = NULL;
+    addr_tree = NULL;
+    lazy_dirty_frees = 0;
+    largest_free_partition = NULL;
+    free_memory = 0;
+    free_partition_count = 0;
+    managed_memory = 0;
+    memset(front_cache_bins, 0, sizeof(front_cache_bins));  // 暂存的分区节点已一并释放
+    memset(front_cache_bin_count, 0, sizeof(front_cache_bin_count));
+    front_cache_memory = 0;
+    
+    buddy_clear();          // 伙伴系统的块一并释放
+    bitmap_clear();         // 位图分配引擎的块和位图一并释放
+    tlsf_clear();           // TLSF分配引擎的块一并释放
+    process_table_clear();  // 进程索引中的分区都已释放
+}
+
+/**
+ * 从节点池中取一个节点：优先复用回收的节点，其次使用当前块中未用的节点，
+ * 都没有时再向系统申请一整块
+ * @param pool 节点池
+ * @return 节点指针，申请内存失败时返回NULL
+ */
+void* pool_alloc(NodePool *pool) {
+    void *node;
+    
+    // 复用回收的节点，O(1)
+    if (pool->free_nodes) {
+        node = pool->free_nodes;
+        pool->free_nodes = *(void **)node;
+        return node;
+    }
+    
+    // 当前块已用完，申请新块
+    if (pool->unused_count == 0) {
+        PoolChunk *chunk = (PoolChunk *)malloc(sizeof(PoolChunk) + pool->node_size * POOL_CHUNK_NODES);
+        if (!chunk) {
+            return NULL;
+        }
+        chunk->next = pool->chunks;
+        pool->chunks = chunk;
+        pool->next_unused = (char *)(chunk + 1);
+        pool->unused_count = POOL_CHUNK_NODES;
+    }
+    
+    // 按地址顺序取用当前块中的节点，相继分配的节点在内存中相邻
+    node = pool->next_unused;
+    pool->next_unused += pool->node_size;
+    pool->unused_count--;
+    return node;
+}
+
+/**
+ * 把节点还给节点池，挂到回收节点链表头部
+ * @param pool 节点池
+ * @param node 节点指针
+ */
+void pool_free(NodePool *pool, void *node) {
+    *(void **)node = pool->free_nodes;
+    pool->free_nodes = node;
+}
+
+/**
+ * 一次性释放节点池的全部内存，池中所有节点随之失效
+ * @param pool 节点池
+ */
+void pool_release_all(NodePool *pool) {
+    PoolChunk *chunk = pool->chunks;
+    
+    while (chunk) {
+        PoolChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    pool->free_nodes = NULL;
+    pool->chunks = NULL;
+    pool->next_unused = NULL;
+    pool->unused_count = 0;
 }
 
 /**
@@ -294,6 +1138,20 @@ void display_memory() {
     Partition *p = memory_list;  // 从链表头开始遍历
     int i = 1;                   // 序号计数器
     
+    // 伙伴系统、位图分配和TLSF有自己的块
+    if (algorithm == BUDDY_SYSTEM) {
+        display_buddy_memory();
+        return;
+    }
+    if (algorithm == BITMAP_SYSTEM) {
+        display_bitmap_memory();
+        return;
+    }
+    if (algorithm == TLSF_SYSTEM) {
+        display_tlsf_memory();
+        return;
+    }
+    
     // 打印表头
     printf("\n当前内存使用情况：\n");
     printf("--------------------------------------------------\n");
@@ -302,46 +1160,86 @@ void display_memory() {
     
     // 遍历链表并打印每个分区的信息
     while (p) {
-        printf("| %-4d | %-8d | %-8d | %-4s | %-10s |\n", 
+        printf("| %-4d | %-8lld | %-8lld | %-4s | %-10s |\n", 
                i++,                                 // 内存分区的序号的变量        %-4d：输出一个整数，占用 4 个字符宽度，左对齐。
                p->start_addr,                       // 当前分区的起始地址          %-8d：输出一个整数，占用 8 个字符宽度，左对齐。
                p->size,                             // 大小                       %-4s：输出一个字符串，占用 4 个字符宽度，左对齐。
-               p->status == FREE ? "空闲" : "已分配", // 状态                      %-10s：输出一个字符串，占用 10 个字符宽度，左对齐。
-               p->process_name);                    // 进程名
+               p->status == FREE ? "空闲" : (p->status == CACHED ? "缓存" : "已分配"), // 状态  %-10s：输出一个字符串，占用 10 个字符宽度，左对齐。
+               process_name_of(p->process_id));     // 进程名（由进程号查得）
         p = p->next;  // 移动到下一个分区
     }
     
     // 打印表尾
     printf("--------------------------------------------------\n");
+    display_fragmentation();
 }
 
 /**
- * 分配内存函数
+ * 分配内存函数，启用ALLOC_PROFILE时记录每次调用的耗时
  * @param req 资源请求结构体，包含进程名和请求大小
+ * @param alignment 起始地址的对齐大小(KB)，必须是2的幂，1表示不要求对齐
+ * @return 分配结果：1-成功，0-失败
+ */
+int allocate_memory(Request req, long long alignment) {
+    int ret;
+    
+    PROFILE_START();
+    ret = allocate_by_policy(req, alignment);
+    PROFILE_STOP(PROFILE_ALLOCATE);
+    return ret;
+}
+
+/**
+ * 按当前算法分配内存，即allocate_memory中除计时以外的部分
+ * @param req 资源请求结构体
+ * @param alignment 起始地址的对齐大小(KB)，必须是2的幂，1表示不要求对齐
  * @return 分配结果：1-成功，0-失败
  */
-int allocate_memory(Request req) {
+int allocate_by_policy(Request req, long long alignment) {
     Partition *target = NULL;        // 目标分区指针
-    Partition *new_partition = NULL; // 新分区指针
-    Partition *prev = NULL;          // 前一个分区指针，用于维护链表
-    Partition *p = memory_list;      // 用于遍历链表
+    Partition *new_partition = NULL; // 新分区指针（分割后剩余的空闲部分）
+    unsigned int process_id;         // 请求进程的进程号
+    long long padding;               // 为满足对齐在目标分区开头跳过的大小
+    
+    if (alignment < 1 || (alignment & (alignment - 1))) {
+        return 0;  // 对齐大小不是2的幂
+    }
+    
+    // 伙伴系统、位图分配和TLSF使用独立的分配引擎
+    if (algorithm == BUDDY_SYSTEM) {
+        return buddy_allocate(req, alignment);
+    }
+    if (algorithm == BITMAP_SYSTEM) {
+        return bitmap_allocate(req, alignment);
+    }
+    if (algorithm == TLSF_SYSTEM) {
+        return tlsf_allocate(req, alignment);
+    }
+    
+    // 前端缓存中有同样大小的分区时直接取用，不查找也不分割
+    if (front_cache_enabled && front_cache_take(req, alignment)) {
+        return 1;
+    }
     
     // 根据当前算法选择合适的分区
-    switch (algorithm) {
-        case FIRST_FIT:  // 最先适应算法
-            target = first_fit(req.size);
-            break;
-            
-        case BEST_FIT:   // 最佳适应算法
-            target = best_fit(req.size);
-            break;
-            
-        case WORST_FIT:  // 最坏适应算法
-            target = worst_fit(req.size);
-            break;
-            
-        default:  // 默认使用最先适应算法
-            target = first_fit(req.size);
+    target = find_aligned_partition(req.size, alignment);
+    
+    // 找不到时先把前端缓存中暂存的分区合并回空闲索引，再试一次
+    if (!target && front_cache_memory > 0) {
+        front_cache_flush();
+        target = find_aligned_partition(req.size, alignment);
+    }
+    
+    // 延迟合并时相邻的空闲分区可能还没有合并，扫描合并后再试一次
+    if (!target && lazy_dirty_frees > 0) {
+        lazy_coalesce_sweep();
+        target = find_aligned_partition(req.size, alignment);
+    }
+    
+    // 仍找不到时，若空闲内存总量足够，紧凑内存后再试一次
+    if (!target && compaction_enabled && free_memory_total() >= req.size) {
+        compact_memory();
+        target = find_aligned_partition(req.size, alignment);
     }
     
     // 如果找不到合适的分区，返回失败
@@ -349,242 +1247,6284 @@ int allocate_memory(Request req) {
         return 0;
     }
     
-    // 找到目标分区在链表中的位置（找到prev）
-    while (p && p != target) {
-        prev = p;
-        p = p->next;
+    // 起始地址不满足对齐时，开头的填充部分留在原节点中作为空闲分区，
+    // 从对齐地址开始的部分成为新的目标分区，填充的空间不会浪费
+    padding = align_up(target->start_addr, alignment) - target->start_addr;
+    if (padding > 0) {
+        target = split_free_partition(target, padding);
+        if (!target) {
+            return 0;
+        }
     }
     
     // 如果找到的空闲分区恰好等于请求大小，直接分配
     if (target->size == req.size) {
+        free_index_remove(target);             // 从空闲分区索引中移除
         target->status = BUSY;                 // 设置状态为已分配
-        strcpy(target->process_name, req.process_name); // 设置进程名
+        target->process_id = intern_process(req.process_name);  // 分区中只保存进程号
+        process_attach(target);                // 记入进程索引
+        next_fit_rover = target->next;         // 下次从本次分配结束处开始查找
         return 1;  // 分配成功
     }
     
     // 如果找到的空闲分区大于请求大小，需要分割
-    new_partition = (Partition *)malloc(sizeof(Partition));
+    new_partition = (Partition *)pool_alloc(&partition_pool);
     if (!new_partition) {
         printf("内存分配失败！\n");  // 分配新分区结构体失败
         return 0;
     }
+    process_id = intern_process(req.process_name);  // 分区结构体已取得后再驻留进程名，失败时不留下空表项
     
-    // 设置新分区的属性（已分配部分）
-    new_partition->start_addr = target->start_addr;   // 新分区的起始地址
-    new_partition->size = req.size;                   // 新分区的大小为请求大小
-    new_partition->status = BUSY;                     // 状态为已分配
-    strcpy(new_partition->process_name, req.process_name);  // 设置进程名
+    // 目标分区的大小即将改变，先从空闲分区索引中移除
+    free_index_remove(target);
     
-    // 修改原分区的属性（剩余空闲部分）
-    target->start_addr += req.size;  // 更新原分区的起始地址
-    target->size -= req.size;        // 更新原分区的大小
-    
-    // 正确插入新分区到链表中
-    if (prev) {
-        // 如果目标分区不是第一个节点
-        prev->next = new_partition;  // 前一个节点指向新分区
-        new_partition->next = target; // 新分区指向原分区
-    } else {
-        // 如果目标分区是第一个节点
-        new_partition->next = target; // 新分区指向原分区
-        memory_list = new_partition;  // 更新链表头
+    // 设置新分区的属性（剩余空闲部分），新分区插在目标分区之后，
+    // 这样无需再从链表头遍历查找目标分区的前驱
+    new_partition->start_addr = target->start_addr + req.size; // 剩余部分紧跟在已分配部分之后
+    new_partition->size = target->size - req.size;             // 剩余部分的大小
+    new_partition->status = FREE;                              // 状态为空闲
+    new_partition->process_id = FREE_PROCESS_ID;
+    new_partition->next = target->next;                        // 插入到目标分区之后
+    new_partition->prev = target;
+    if (target->next) {
+        target->next->prev = new_partition;
     }
+    target->next = new_partition;
+    free_index_insert(new_partition);                          // 剩余部分加入空闲分区索引
+    addr_index_insert(new_partition);                          // 以及地址索引
+    
+    // 修改原分区的属性（已分配部分），起始地址不变
+    target->size = req.size;                               // 大小为请求大小
+    target->status = BUSY;                                 // 状态为已分配
+    target->process_id = process_id;                       // 设置进程号
+    process_attach(target);                                // 记入进程索引
+    next_fit_rover = new_partition;                        // 下次从剩余的空闲部分开始查找
     
     return 1;  // 分配成功
 }
 
 /**
- * 释放内存函数
- * @param process_name 要释放内存的进程名
- * @return 释放结果：1-成功，0-失败（未找到进程）
+ * 按当前算法查找合适的空闲分区
+ * @param size 请求的内存大小
+ * @return 找到的分区指针，如果没找到返回NULL
  */
-int release_memory(char *process_name) { //函数接收一个 char *process_name 参数，这个参数是一个字符串，表示要释放内存的进程名称。
-    Partition *p = memory_list;  // 从链表头开始遍历
-    int found = 0;               // 标记是否找到匹配的进程
+Partition* find_free_partition(long long size) {
+    Partition *found;
     
-    // 查找并释放所有与process_name匹配的分区
-    while (p) {
-        if (p->status == BUSY && strcmp(p->process_name, process_name) == 0) { 
-            //检查当前分区是否已经被分配（p->status == BUSY），并且该分区的进程名称是否与给定的 process_name 相匹配
-            p->status = FREE;                // 设置状态为空闲
-            strcpy(p->process_name, "空闲");  // 更新进程名为"空闲"
-            found = 1;                       // 标记找到匹配的进程
-        }
-        p = p->next;  // 继续检查下一个分区
-    }
-    
-    // 如果找到并释放了内存，尝试合并相邻的空闲分区
-    if (found) {
-        merge_free_partitions();  // 合并相邻空闲分区
-        return 1;  // 释放成功
+    PROFILE_START();
+    switch (algorithm) {
+        case FIRST_FIT:  // 最先适应算法
+            found = first_fit(size);
+            break;
+            
+        case BEST_FIT:   // 最佳适应算法
+            found = best_fit(size);
+            break;
+            
+        case WORST_FIT:  // 最坏适应算法
+            found = worst_fit(size);
+            break;
+            
+        case NEXT_FIT:   // 循环首次适应算法
+            found = next_fit(size);
+            break;
+            
+        default:  // 默认使用最先适应算法
+            found = first_fit(size);
     }
-    
-    return 0;  // 未找到匹配的进程
+    PROFILE_STOP(PROFILE_SEARCH);
+    return found;
 }
 
 /**
- * 最先适应算法：查找第一个足够大的空闲分区
- * @param size 请求的内存大小
- * @return 找到的分区指针，如果没找到返回NULL
+ * 把地址向上对齐到alignment的倍数
+ * @param addr 地址
+ * @param alignment 对齐大小，必须是2的幂
+ * @return 不小于addr的最小的alignment的倍数
  */
-Partition* first_fit(int size) {
-    Partition *p = memory_list;  // 从链表头开始查找  p 用于遍历整个链表，查找符合条件的空闲内存分区
-    
-    // 遍历链表，查找第一个足够大的空闲分区
-    while (p) {
-        if (p->status == FREE && p->size >= size) {  //判断当前分区 p 是否为空闲 并且 该分区的大小是否大于或等于请求的内存大小
-            return p;  // 找到合适分区，返回分区指针
-        }
-        p = p->next;  // 继续检查下一个分区
-    }
-    
-    return NULL;  // 没有找到合适的分区
+long long align_up(long long addr, long long alignment) {
+    return (addr + alignment - 1) & ~(alignment - 1);
 }
 
 /**
- * 最佳适应算法：查找最小的且足够大的空闲分区
+ * 查找能放下按alignment对齐的请求的空闲分区
+ * 先按当前算法查找不小于size+alignment-1的分区，这样的分区无论起始地址如何都放得下；
+ * 找不到时再检查大小在size与size+alignment-1之间、恰好能按对齐放下的分区，取地址最低者
  * @param size 请求的内存大小
+ * @param alignment 对齐大小，必须是2的幂
  * @return 找到的分区指针，如果没找到返回NULL
  */
-Partition* best_fit(int size) {
-    Partition *p = memory_list;      // 从链表头开始查找
-    Partition *best = NULL;          // 最佳匹配分区指针
-    int min_size = total_memory_size + 1;  // 初始化为一个很大的值
+Partition* find_aligned_partition(long long size, long long alignment) {
+    Partition *found;
+    int last;  // 更高级中的分区都不小于size+alignment-1，上面已经查找过
     
-    // 遍历链表，查找最佳匹配分区
-    while (p) {
-        if (p->status == FREE && p->size >= size) {   // 分区必须是空闲的且大小足够
-            // 最佳适应是找到最小的足够大的分区，而不是差值最小
-            if (p->size < min_size) {                 // 如果找到更小的合适分区
-                min_size = p->size;                   // 更新最小分区大小
-                best = p;                             // 更新最佳匹配分区
-//                printf("%d",min_size);
+    if (alignment == 1) {
+        return find_free_partition(size);
+    }
+    
+    found = find_free_partition(size + alignment - 1);
+    if (found) {
+        return found;
+    }
+    
+    last = size_class(size + alignment - 1);
+    for (int k = size_class(size); k <= last; k++) {
+        for (Partition *p = free_lists[k]; p; p = p->free_next) {
+            if (align_up(p->start_addr, alignment) + size <= p->start_addr + p->size &&
+                (!found || p->start_addr < found->start_addr)) {
+                found = p;
             }
         }
-        p = p->next;  // 继续检查下一个分区
     }
-    
-    return best;  // 返回最佳分区或NULL
+    return found;
 }
 
 /**
- * 最坏适应算法：查找剩余空间最大的空闲分区
- * @param size 请求的内存大小
- * @return 找到的分区指针，如果没找到返回NULL
+ * 把空闲分区分成两个空闲分区：前head_size保留在原节点中，其余部分成为插在其后的新节点
+ * 两者都在空闲分区索引中，调用者应立即分配后一个分区，不应让两个相邻的空闲分区长期存在
+ * @param p 空闲分区，大小必须大于head_size
+ * @param head_size 保留在原节点中的大小
+ * @return 后一个分区，节点分配失败时返回NULL（原分区不变）
  */
-Partition* worst_fit(int size) {
-    Partition *p = memory_list;  // 从链表头开始查找
-    Partition *worst = NULL;     // 最坏匹配分区指针
-    int max_diff = -1;           // 初始化为一个很小的值   用于记录当前找到的分区与请求大小的差值
+Partition* split_free_partition(Partition *p, long long head_size) {
+    Partition *rest = (Partition *)pool_alloc(&partition_pool);
     
-    // 遍历链表，查找最坏匹配分区
-    while (p) {
-        if (p->status == FREE && p->size >= size) {
-            //检查当前分区是否为空闲 ，并且该分区的大小是否大于或等于请求的内存大小
-            int diff = p->size - size;  // 计算当前分区与请求大小的差值
-            if (diff > max_diff) {      // 如果差值更大，更新最坏匹配
-                max_diff = diff;        // 更新最大差值        如果找到了更大的差值，更新 max_diff 为当前差值
-                worst = p;              // 更新最坏匹配分区
-            }
-        }
-        p = p->next;  // 继续检查下一个分区
+    if (!rest) {
+        printf("内存分配失败！\n");
+        return NULL;
     }
     
-    return worst;  // 返回最坏分区或NULL    返回找到的最坏匹配分区指针 worst
+    free_index_remove(p);  // 大小即将改变，先移出空闲分区索引
+    rest->start_addr = p->start_addr + head_size;
+    rest->size = p->size - head_size;
+    rest->status = FREE;
+    rest->process_id = FREE_PROCESS_ID;
+    rest->next = p->next;
+    rest->prev = p;
+    if (p->next) {
+        p->next->prev = rest;
+    }
+    p->next = rest;
+    p->size = head_size;
+    addr_index_insert(rest);
+    free_index_insert(p);
+    free_index_insert(rest);
+    return rest;
 }
 
 /**
- * 合并相邻的空闲分区
+ * 统计空闲内存总量，由空闲分区索引增量维护
+ * @return 空闲内存总量(KB)
  */
-void merge_free_partitions() {
-    Partition *current, *next;
-    int merged;
-
-    do {
-        merged = 0;
-        current = memory_list;
-
-        while (current && current->next) {
-            next = current->next;
-
-            // 检查当前分区和下一个分区是否都为空闲
-            if (current->status == FREE && next->status == FREE) {
-                // *** 新增检查：判断两个空闲分区在物理地址上是否连续 ***
-                if (current->start_addr + current->size == next->start_addr) {
-                    // 物理地址连续，可以合并
-                    current->size += next->size;      // 增加当前分区的大小
-                    current->next = next->next;       // 从链表中移除下一个分区
-                    free(next);                       // 释放被合并分区的节点内存
-                    merged = 1;                       // 标记发生了合并
-
-                    // 合并后，当前分区可能能与再下一个分区合并，
-                    // 因此使用 break 跳出内层循环，让外层 do-while 重新从头开始扫描
-                    break;
-                } else {
-                    // 物理地址不连续，不能合并，继续检查下一对
-                    current = current->next;
-                }
-            } else {
-                // 至少有一个分区不是空闲，不能合并，继续检查下一对
-                current = current->next;
-            }
-        }
-        // 如果内层循环正常结束（没有break），表示本次扫描没有合并发生或已到链表尾部
-    } while (merged); // 如果本次扫描发生了合并，则重新从头开始检查，确保所有可合并的都已合并
+long long free_memory_total() {
+    return free_memory;
 }
 
-//两个 while 循环的组合，确保了：
-//  在每次合并之后，链表会被重新检查，以确保所有相邻的空闲分区都被合并。
-//  在每次遍历链表时，检查相邻的空闲分区并合并它们。
-
 /**
- * 打印功能菜单
+ * 紧凑内存：在每个连续的内存段内，把已分配分区依次移到段的低地址端，
+ * 段内全部空闲空间合并为段末尾的一个空闲分区。各段之间的间隙保持不变。
+ * 统计移动的数据量和花费的时间
  */
-void print_menu() {
-    char *alg_name;  // 算法名称字符串，声明一个指向字符的指针 alg_name，用于存储当前选择的内存分配算法的名称
+void compact_memory() {
+    double start = get_time_seconds();
+    Partition *p;
     
-    // 根据当前算法设置算法名称
-    if (algorithm == FIRST_FIT) {
-        alg_name = "最先适应";
-    } else if (algorithm == BEST_FIT) {
-        alg_name = "最佳适应";
-    } else {
-        alg_name = "最坏适应";
+    front_cache_flush();  // 暂存的分区也是空闲空间，先合并回空闲索引
+    p = memory_list;
+    
+    while (p) {
+        Partition *before = p->prev;   // 段前面的分区（段是链表头时为NULL）
+        Partition *tail = before;      // 段内最后一个保留下来的已分配分区
+        long long addr = p->start_addr;  // 段内下一个已分配分区应放置的地址
+        long long end;                   // 段的结束地址
+        
+        // 处理一个连续段：段内相邻分区首尾相接
+        while (1) {
+            Partition *next = p->next;
+            int continues = next && p->start_addr + p->size == next->start_addr;
+            
+            end = p->start_addr + p->size;
+            if (p->status == BUSY) {
+                if (p->start_addr != addr) {
+                    compaction_moved += p->size;  // 分区内容需要搬移
+                    p->start_addr = addr;
+                }
+                addr += p->size;
+                tail = p;
+            } else {
+                // 空闲分区先删除，最后在段末尾统一重建
+                free_index_remove(p);
+                if (p->prev) {
+                    p->prev->next = p->next;
+                } else {
+                    memory_list = p->next;
+                }
+                if (p->next) {
+                    p->next->prev = p->prev;
+                }
+                pool_free(&partition_pool, p);
+            }
+            
+            p = next;
+            if (!continues) {
+                break;
+            }
+        }
+        
+        // 段末尾剩余的空间成为一个空闲分区，插在段内最后一个已分配分区之后
+        if (addr < end) {
+            Partition *hole = (Partition *)pool_alloc(&partition_pool);
+            if (!hole) {
+                printf("内存分配失败！\n");
+                exit(1);
+            }
+            hole->start_addr = addr;
+            hole->size = end - addr;
+            hole->status = FREE;
+            hole->process_id = FREE_PROCESS_ID;
+            hole->prev = tail;
+            hole->next = tail ? tail->next : memory_list;
+            if (hole->next) {
+                hole->next->prev = hole;
+            }
+            if (tail) {
+                tail->next = hole;
+            } else {
+                memory_list = hole;
+            }
+            free_index_insert(hole);
+        }
+    }
+    
+    next_fit_rover = NULL;  // 原来的空闲分区节点已删除，游标回到链表头
+    addr_index_rebuild();   // 节点删除和新建较多，按链表整体重建地址索引
+    lazy_dirty_frees = 0;   // 各段的空闲空间已合并为一个分区
+    compaction_count++;
+    compaction_seconds += get_time_seconds() - start;
+}
+
+/**
+ * 批量分配时的排序比较函数：大小从大到小，大小相同时保持原始顺序
+ */
+int compare_batch_items(const void *a, const void *b) {
+    const BatchItem *x = (const BatchItem *)a;
+    const BatchItem *y = (const BatchItem *)b;
+    
+    if (x->size != y->size) {
+        return x->size > y->size ? -1 : 1;
+    }
+    return x->index - y->index;
+}
+
+/**
+ * 把批量请求按大小从大到小排序，大小相同时保持原始顺序（与compare_batch_items一致）。
+ * 一组请求通常只有几十个，插入排序比qsort逐次调用比较函数更快，较大的批量再用qsort
+ * @param items 请求数组
+ * @param n 请求数量
+ */
+void sort_batch_items(BatchItem *items, int n) {
+    if (n > BATCH_LOCAL_ITEMS) {
+        qsort(items, n, sizeof(BatchItem), compare_batch_items);
+        return;
+    }
+    for (int i = 1; i < n; i++) {
+        BatchItem item = items[i];
+        int j = i;
+        
+        while (j > 0 && items[j - 1].size < item.size) {
+            items[j] = items[j - 1];
+            j--;
+        }
+        items[j] = item;
+    }
+}
+
+/**
+ * 批量分配内存：一次接纳一组请求
+ * 先按大小从大到小排序。可变分区算法在一遍中放置：每次取出当前最大的空闲分区，
+ * 从头依次切出尚未放置、且放得下的最大请求，直到剩余部分放不下任何请求，再放回空闲分区索引，
+ * 所以每个空闲分区只从索引中取出和放回一次，而不是每个请求查找一次；
+ * 当前最大的空闲分区也放不下剩余的请求时结束，剩余的请求再逐个分配（可能使用前端缓存、合并或紧凑）。
+ * 伙伴系统、位图分配和TLSF按排序后的顺序逐个分配。
+ * 大请求先占用大空闲块，小请求填入剩余的空隙，比按到达顺序逐个分配的失败更少
+ * @param reqs 请求数组
+ * @param n 请求数量
+ * @param results 输出每个请求的分配结果：1-成功，0-失败（可以为NULL）
+ * @return 成功分配的请求数
+ */
+int allocate_batch(Request *reqs, int n, int *results) {
+    BatchItem local_items[BATCH_LOCAL_ITEMS];  // 小批量直接使用栈上的数组
+    BatchItem *items = local_items;
+    int admitted = 0;  // 成功分配的请求数
+    int pending = n;   // 尚未放置的请求数，items的前pending项
+    
+    if (n <= 0) {
+        return 0;
+    }
+    
+    if (n > BATCH_LOCAL_ITEMS) {
+        items = (BatchItem *)malloc(sizeof(BatchItem) * n);
+        if (!items) {
+            printf("内存分配失败！\n");
+            return 0;
+        }
+    }
+    
+    for (int i = 0; i < n; i++) {
+        items[i].size = reqs[i].size;
+        items[i].index = i;
+    }
+    sort_batch_items(items, n);
+    
+    // 可变分区算法：从最大的空闲分区开始，每个分区依次切给放得下的最大请求
+    if (algorithm != BUDDY_SYSTEM && algorithm != BITMAP_SYSTEM && algorithm != TLSF_SYSTEM) {
+        Partition *hole;
+        
+        while (pending > 0 && (hole = largest_free_partition) && hole->size >= items[pending - 1].size) {
+            int kept = 0;  // 这个分区放不下、留给后续分区的请求数
+            
+            free_index_remove(hole);
+            for (int i = 0; i < pending; i++) {
+                Request *req = &reqs[items[i].index];
+                
+                if (!hole || req->size <= 0 || req->size > hole->size) {
+                    items[kept++] = items[i];
+                    continue;
+                }
+                
+                if (req->size == hole->size) {
+                    // 恰好放满：剩余部分直接成为已分配分区
+                    hole->status = BUSY;
+                    hole->process_id = intern_process(req->process_name);
+                    process_attach(hole);
+                    next_fit_rover = hole->next;
+                    hole = NULL;
+                } else {
+                    // 从分区开头切出已分配部分，新节点插在剩余部分之前；
+                    // 剩余部分的起始地址后移，但仍在前后分区之间，地址索引中的顺序不变
+                    Partition *busy = (Partition *)pool_alloc(&partition_pool);
+                    if (!busy) {
+                        printf("内存分配失败！\n");
+                        items[kept++] = items[i];
+                        continue;
+                    }
+                    busy->start_addr = hole->start_addr;
+                    busy->size = req->size;
+                    busy->status = BUSY;
+                    busy->process_id = intern_process(req->process_name);
+                    busy->prev = hole->prev;
+                    busy->next = hole;
+                    if (hole->prev) {
+                        hole->prev->next = busy;
+                    } else {
+                        memory_list = busy;
+                    }
+                    hole->prev = busy;
+                    hole->start_addr += req->size;
+                    hole->size -= req->size;
+                    addr_index_insert(busy);
+                    process_attach(busy);
+                    next_fit_rover = hole;
+                }
+                if (results) {
+                    results[items[i].index] = 1;
+                }
+                admitted++;
+            }
+            
+            // 剩余部分放不下任何尚未放置的请求；它若仍是最大的空闲分区，下一轮循环即结束
+            if (hole) {
+                free_index_insert(hole);
+            }
+            if (kept == pending) {
+                break;  // 一个请求也没有放下（请求大小无效），交给逐个分配
+            }
+            pending = kept;
+        }
+    }
+    
+    // 其余请求按排序后的顺序逐个放置，每次查找都走空闲分区索引，不再遍历整个链表
+    for (int i = 0; i < pending; i++) {
+        int ok = allocate_memory(reqs[items[i].index], 1);
+        if (results) {
+            results[items[i].index] = ok;
+        }
+        admitted += ok;
+    }
+    
+    if (items != local_items) {
+        free(items);
+    }
+    return admitted;
+}
+
+/**
+ * 释放内存函数
+ * @param process_name 要释放内存的进程名
+ * @return 释放结果：1-成功，0-失败（未找到进程）
+ */
+int release_memory(char *process_name) { //函数接收一个 char *process_name 参数，这个参数是一个字符串，表示要释放内存的进程名称。
+    int ret;
+    
+    PROFILE_START();
+    ret = release_by_policy(process_name);
+    PROFILE_STOP(PROFILE_RELEASE);
+    return ret;
+}
+
+/**
+ * 按当前算法释放进程的全部内存，即release_memory中除计时以外的部分
+ * @param process_name 要释放内存的进程名称
+ * @return 释放结果：1-成功，0-失败（未找到进程）
+ */
+int release_by_policy(char *process_name) {
+    ProcessEntry *e = process_lookup(process_name, 0);  // 在进程索引中查找该进程
+    Partition *p, *next;
+    
+    // 伙伴系统、位图分配和TLSF使用独立的释放和合并过程
+    if (algorithm == BUDDY_SYSTEM) {
+        return buddy_release(process_name);
+    }
+    if (algorithm == BITMAP_SYSTEM) {
+        return bitmap_release(process_name);
+    }
+    if (algorithm == TLSF_SYSTEM) {
+        return tlsf_release(process_name);
+    }
+    
+    if (!e || !e->partitions) {
+        return 0;  // 未找到匹配的进程
+    }
+    
+    // 只遍历该进程占用的分区，而不是整个内存链表
+    for (p = e->partitions; p; p = next) {
+        next = p->owner_next;
+        p->owner_prev = NULL;
+        p->owner_next = NULL;
+        release_partition(p);
+    }
+    e->partitions = NULL;
+    process_remove_if_empty(e);
+    
+    return 1;  // 释放成功
+}
+
+/**
+ * 把已从进程分区链表中摘下的分区变为空闲：启用前端缓存时优先暂存，
+ * 否则加入空闲分区索引并立即与地址相邻的空闲分区合并；
+ * 启用延迟合并时不合并，未合并的释放累计到阈值时做一次合并扫描
+ * @param p 要释放的分区
+ */
+void release_partition(Partition *p) {
+    if (front_cache_enabled && front_cache_park(p)) {
+        return;                          // 暂存在前端缓存中，暂不合并
+    }
+    p->status = FREE;                    // 设置状态为空闲
+    p->process_id = FREE_PROCESS_ID;     // 进程号改为空闲
+    free_index_insert(p);                // 加入空闲分区索引
+    if (lazy_coalesce_enabled) {
+        if (++lazy_dirty_frees >= lazy_coalesce_threshold) {
+            lazy_coalesce_sweep();       // 累计到阈值，批量合并
+        }
+        return;
+    }
+    coalesce_partition(p);               // 立即与地址相邻的空闲分区合并
+}
+
+/**
+ * 延迟合并的合并扫描：对分区链表做一次线性扫描，合并所有相邻的空闲分区
+ * 在分配找不到空闲分区、未合并的释放达到阈值、关闭延迟合并或保存快照时调用
+ */
+void lazy_coalesce_sweep() {
+    if (lazy_dirty_frees == 0) {
+        return;  // 上次扫描之后没有未合并的释放，不存在相邻的空闲分区
+    }
+    merge_free_partitions();
+    lazy_dirty_frees = 0;
+    lazy_sweeps++;
+}
+
+/**
+ * 按地址释放内存：释放从addr开始的已分配分区，与malloc/free日志中按地址释放的方式相同
+ * 由地址索引在O(log n)时间内找到分区，只释放这一个分区，进程的其他分区不变
+ * 只用于可变分区，伙伴系统、位图分配和TLSF没有地址索引
+ * @param addr 分区的起始地址
+ * @return 释放结果：1-成功，0-失败（该地址不是已分配分区的起始地址）
+ */
+int release_at(long long addr) {
+    Partition *p;
+    ProcessEntry *e;
+    
+    if (algorithm >= BUDDY_SYSTEM) {
+        return 0;
+    }
+    p = lookup_address(addr);
+    if (!p || p->status != BUSY || p->start_addr != addr) {
+        return 0;
+    }
+    
+    // 从所属进程的分区链表中摘下
+    e = process_by_id[p->process_id];
+    if (p->owner_prev) {
+        p->owner_prev->owner_next = p->owner_next;
+    } else {
+        e->partitions = p->owner_next;
+    }
+    if (p->owner_next) {
+        p->owner_next->owner_prev = p->owner_prev;
+    }
+    p->owner_prev = NULL;
+    p->owner_next = NULL;
+    
+    release_partition(p);
+    process_remove_if_empty(e);
+    return 1;
+}
+
+/**
+ * 查找包含指定地址的分区：在地址索引中找起始地址不大于addr的最后一个分区，O(log n)
+ * @param addr 要查找的地址
+ * @return 包含该地址的分区（空闲、已分配或暂存在前端缓存中），地址落在段间间隙或超出内存时返回NULL
+ */
+Partition* lookup_address(long long addr) {
+    TreeNode *n = addr_tree;
+    Partition *found = NULL;
+    
+    while (n) {
+        Partition *p = PARTITION_OF(n, addr_node);
+        if (p->start_addr <= addr) {
+            found = p;       // 候选分区，继续在右子树中找更靠后的
+            n = n->right;
+        } else {
+            n = n->left;
+        }
+    }
+    return found && addr < found->start_addr + found->size ? found : NULL;
+}
+
+/**
+ * 调整进程内存的大小，进程占用多个分区时调整最近分配的那个分区
+ * 缩小时把尾部分割出来，作为空闲分区与后面的空闲分区合并；
+ * 扩大时若后面紧邻的空闲分区足够大，就地吸收其开头部分；
+ * 都不行时才另外分配一个分区并把数据搬过去（不保留原来的对齐），再释放原分区
+ * @param process_name 进程名
+ * @param new_size 新的大小(KB)
+ * @return 调整结果：1-成功，0-失败（未找到进程或没有足够的空间，原分区保持不变）
+ */
+int realloc_memory(const char *process_name, long long new_size) {
+    ProcessEntry *e;
+    Partition *p, *next;
+    Request req;
+    
+    if (new_size <= 0) {
+        return 0;
+    }
+    
+    // 伙伴系统、位图分配和TLSF使用独立的调整过程
+    if (algorithm == BUDDY_SYSTEM) {
+        return buddy_realloc(process_name, new_size);
+    }
+    if (algorithm == BITMAP_SYSTEM) {
+        return bitmap_realloc(process_name, new_size);
+    }
+    if (algorithm == TLSF_SYSTEM) {
+        return tlsf_realloc(process_name, new_size);
+    }
+    
+    e = process_lookup(process_name, 0);
+    if (!e || !e->partitions) {
+        return 0;  // 未找到匹配的进程
+    }
+    p = e->partitions;  // 新分配的分区挂在进程分区链表头部
+    next = p->next;
+    
+    if (new_size == p->size) {
+        return 1;
+    }
+    
+    // 缩小：尾部成为插在原分区之后的空闲分区
+    if (new_size < p->size) {
+        Partition *tail = (Partition *)pool_alloc(&partition_pool);
+        if (!tail) {
+            printf("内存分配失败！\n");
+            return 0;
+        }
+        tail->start_addr = p->start_addr + new_size;
+        tail->size = p->size - new_size;
+        tail->status = FREE;
+        tail->process_id = FREE_PROCESS_ID;
+        tail->next = next;
+        tail->prev = p;
+        if (next) {
+            next->prev = tail;
+        }
+        p->next = tail;
+        p->size = new_size;
+        free_index_insert(tail);
+        addr_index_insert(tail);
+        coalesce_partition(tail);  // 与后面紧邻的空闲分区合并
+        return 1;
+    }
+    
+    // 扩大：后面紧邻的空闲分区足够大时就地扩展，不搬移数据
+    if (next && next->status == FREE && p->start_addr + p->size == next->start_addr &&
+        next->size >= new_size - p->size) {
+        long long grow = new_size - p->size;
+        
+        free_index_remove(next);
+        if (next->size == grow) {
+            // 整个空闲分区都被吸收，删除其节点
+            p->next = next->next;
+            if (next->next) {
+                next->next->prev = p;
+            }
+            if (next_fit_rover == next) {
+                next_fit_rover = p->next;
+            }
+            addr_index_remove(next);
+            pool_free(&partition_pool, next);
+        } else {
+            next->start_addr += grow;
+            next->size -= grow;
+            free_index_insert(next);
+        }
+        p->size = new_size;
+        return 1;
+    }
+    
+    // 原地无法扩大：先另外分配，成功后再释放原分区，失败时原分区保持不变
+    strcpy(req.process_name, e->process_name);
+    req.size = new_size;
+    if (!allocate_memory(req, 1)) {
+        return 0;
+    }
+    realloc_moved += p->size;
+    
+    // 新分区挂在了进程分区链表头部，把原分区从链表中摘下后释放
+    if (p->owner_prev) {
+        p->owner_prev->owner_next = p->owner_next;
+    } else {
+        e->partitions = p->owner_next;
+    }
+    if (p->owner_next) {
+        p->owner_next->owner_prev = p->owner_prev;
+    }
+    p->owner_prev = NULL;
+    p->owner_next = NULL;
+    release_partition(p);  // 与其他释放一样使用前端缓存和延迟合并
+    return 1;
+}
+
+/**
+ * 从前端缓存中取出与请求大小相同的分区直接分配，不查找空闲索引也不分割
+ * @param req 资源请求结构体
+ * @param alignment 起始地址的对齐大小(KB)，缓存中最近暂存的分区不满足对齐时不使用缓存
+ * @return 1-已由缓存满足，0-缓存中没有可用的分区
+ */
+int front_cache_take(Request req, long long alignment) {
+    Partition *p;
+    
+    if (req.size <= 0 || req.size > FRONT_CACHE_MAX_SIZE) {
+        return 0;
+    }
+    p = front_cache_bins[req.size];
+    if (!p || p->start_addr % alignment != 0) {
+        front_cache_misses++;
+        return 0;
+    }
+    
+    front_cache_bins[req.size] = p->free_next;
+    front_cache_bin_count[req.size]--;
+    front_cache_memory -= p->size;
+    p->free_next = NULL;
+    p->status = BUSY;
+    p->process_id = intern_process(req.process_name);
+    process_attach(p);
+    front_cache_hits++;
+    return 1;
+}
+
+/**
+ * 把刚释放（已从进程分区链表中摘下）的分区暂存到前端缓存中，暂不合并
+ * 分区太大、所在缓存桶已满或缓存总量已到上限时不暂存；
+ * 外部碎片率过高说明暂存的分区妨碍了空闲分区的合并，此时清空整个缓存
+ * @param p 刚释放的分区
+ * @return 1-已暂存，0-未暂存，调用者按正常流程释放并合并
+ */
+int front_cache_park(Partition *p) {
+    if (p->size > FRONT_CACHE_MAX_SIZE || front_cache_bin_count[p->size] >= FRONT_CACHE_BIN_LIMIT ||
+        front_cache_memory + p->size > managed_memory / FRONT_CACHE_MEMORY_SHARE) {
+        return 0;
+    }
+    if (external_fragmentation(free_memory, largest_free_partition ? largest_free_partition->size : 0) >
+        FRONT_CACHE_MAX_FRAGMENTATION) {
+        front_cache_flush();
+        return 0;
+    }
+    
+    p->status = CACHED;
+    p->process_id = FREE_PROCESS_ID;
+    p->free_next = front_cache_bins[p->size];
+    front_cache_bins[p->size] = p;
+    front_cache_bin_count[p->size]++;
+    front_cache_memory += p->size;
+    return 1;
+}
+
+/**
+ * 清空前端缓存：暂存的分区全部变为空闲分区，加入空闲分区索引并与相邻的空闲分区合并
+ */
+void front_cache_flush() {
+    if (front_cache_memory == 0) {
+        return;
+    }
+    
+    for (int size = 1; size <= FRONT_CACHE_MAX_SIZE; size++) {
+        Partition *p = front_cache_bins[size];
+        
+        while (p) {
+            Partition *next = p->free_next;
+            
+            p->free_next = NULL;
+            p->status = FREE;
+            free_index_insert(p);
+            coalesce_partition(p);
+            p = next;
+        }
+        front_cache_bins[size] = NULL;
+        front_cache_bin_count[size] = 0;
+    }
+    front_cache_memory = 0;
+    front_cache_flushes++;
+}
+
+/**
+ * 计算进程名的哈希值（FNV-1a算法）
+ * @param process_name 进程名
+ * @return 哈希值
+ */
+unsigned int hash_process_name(const char *process_name) {
+    unsigned int h = 2166136261u;
+    
+    while (*process_name) {
+        h ^= (unsigned char)*process_name++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/**
+ * 把哈希表扩大一倍，并把所有表项重新分配到新桶中
+ */
+void process_table_grow() {
+    int new_size = process_table_size ? process_table_size * 2 : PROCESS_TABLE_INITIAL_SIZE;
+    ProcessEntry **new_table = (ProcessEntry **)calloc(new_size, sizeof(ProcessEntry *));
+    
+    if (!new_table) {
+        printf("内存分配失败！\n");
+        exit(1);
+    }
+    
+    for (int i = 0; i < process_table_size; i++) {
+        ProcessEntry *e = process_table[i];
+        while (e) {
+            ProcessEntry *next = e->next;
+            unsigned int slot = hash_process_name(e->process_name) & (new_size - 1);
+            e->next = new_table[slot];
+            new_table[slot] = e;
+            e = next;
+        }
+    }
+    
+    free(process_table);
+    process_table = new_table;
+    process_table_size = new_size;
+}
+
+/**
+ * 按进程名查找进程索引表项
+ * @param process_name 进程名
+ * @param create 找不到时是否创建新表项
+ * @return 表项指针，找不到且不创建时返回NULL
+ */
+ProcessEntry* process_lookup(const char *process_name, int create) {
+    unsigned int slot;
+    ProcessEntry *e;
+    
+    if (!process_table) {
+        if (!create) {
+            return NULL;
+        }
+        process_table_grow();
+    }
+    
+    slot = hash_process_name(process_name) & (process_table_size - 1);
+    for (e = process_table[slot]; e; e = e->next) {
+        if (strcmp(e->process_name, process_name) == 0) {
+            return e;
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+    
+    // 平均每个桶超过一个表项时扩容，保证查找为O(1)
+    if (process_count >= process_table_size) {
+        process_table_grow();
+        slot = hash_process_name(process_name) & (process_table_size - 1);
+    }
+    
+    if (free_process_entries) {
+        // 复用回收的表项及其进程号
+        e = free_process_entries;
+        free_process_entries = e->next;
+    } else {
+        e = (ProcessEntry *)malloc(sizeof(ProcessEntry));
+        if (!e) {
+            printf("内存分配失败！\n");
+            exit(1);
+        }
+        e->process_id = (unsigned int)++process_id_count;
+        
+        // 进程号连续分配，由进程号找表项是O(1)的数组访问
+        if (process_id_count >= process_by_id_capacity) {
+            int capacity = process_by_id_capacity ? process_by_id_capacity * 2 : PROCESS_TABLE_INITIAL_SIZE;
+            ProcessEntry **grown = (ProcessEntry **)realloc(process_by_id, sizeof(ProcessEntry *) * capacity);
+            if (!grown) {
+                printf("内存分配失败！\n");
+                exit(1);
+            }
+            process_by_id = grown;
+            process_by_id_capacity = capacity;
+        }
+        process_by_id[e->process_id] = e;
+    }
+    strcpy(e->process_name, process_name);
+    e->partitions = NULL;
+    e->buddy_blocks = NULL;
+    e->bitmap_blocks = NULL;
+    e->tlsf_blocks = NULL;
+    e->table_partitions = 0;
+    e->next = process_table[slot];
+    process_table[slot] = e;
+    process_count++;
+    return e;
+}
+
+/**
+ * 驻留进程名：第一次出现时分配新的进程号，之后返回同一个进程号
+ * @param process_name 进程名
+ * @return 进程号（从1开始）
+ */
+unsigned int intern_process(const char *process_name) {
+    return process_lookup(process_name, 1)->process_id;
+}
+
+/**
+ * 由进程号得到进程名
+ * @param process_id 进程号
+ * @return 进程名，空闲时为"空闲"
+ */
+const char* process_name_of(unsigned int process_id) {
+    return process_id == FREE_PROCESS_ID ? "空闲" : process_by_id[process_id]->process_name;
+}
+
+/**
+ * 把已分配分区挂到所属进程的分区链表头部
+ * @param p 已分配分区，process_id已设置
+ */
+void process_attach(Partition *p) {
+    ProcessEntry *e = process_by_id[p->process_id];
+    
+    p->owner_prev = NULL;
+    p->owner_next = e->partitions;
+    if (e->partitions) {
+        e->partitions->owner_prev = p;
+    }
+    e->partitions = p;
+}
+
+/**
+ * 进程在所有分配引擎中都不再占用内存时，从哈希表中删除其表项，
+ * 表项放入空闲表项链表，进程号留给下一个新进程
+ * @param e 进程索引表项
+ */
+void process_remove_if_empty(ProcessEntry *e) {
+    unsigned int slot;
+    ProcessEntry **link;
+    
+    if (e->partitions || e->buddy_blocks || e->bitmap_blocks || e->tlsf_blocks || e->table_partitions) {
+        return;
+    }
+    
+    slot = hash_process_name(e->process_name) & (process_table_size - 1);
+    for (link = &process_table[slot]; *link; link = &(*link)->next) {
+        if (*link == e) {
+            *link = e->next;
+            e->next = free_process_entries;
+            free_process_entries = e;
+            process_count--;
+            return;
+        }
+    }
+}
+
+/**
+ * 清空进程索引，释放全部表项
+ */
+void process_table_clear() {
+    // 哈希表中的表项和回收的表项都登记在按进程号索引的数组中
+    for (int id = 1; id <= process_id_count; id++) {
+        free(process_by_id[id]);
+    }
+    free(process_table);
+    process_table = NULL;
+    process_table_size = 0;
+    process_count = 0;
+    free(process_by_id);
+    process_by_id = NULL;
+    process_by_id_capacity = 0;
+    process_id_count = 0;
+    free_process_entries = NULL;
+}
+
+/**
+ * 计算分区大小所属的分级：第k级对应大小范围[2^k, 2^(k+1))
+ * @param size 分区大小
+ * @return 分级编号
+ */
+int size_class(long long size) {
+    int k = 0;
+    
+    // 求size以2为底的对数（向下取整），超出范围的归入最高一级
+    while (size > 1 && k < SIZE_CLASS_COUNT - 1) {
+        size >>= 1;
+        k++;
+    }
+    
+    return k;
+}
+
+/**
+ * 将空闲分区插入其大小级对应的空闲链表头部
+ * @param p 空闲分区指针
+ */
+void free_list_insert(Partition *p) {
+    int k = size_class(p->size);  // 分区所属的大小级
+    
+    p->free_prev = NULL;
+    p->free_next = free_lists[k];
+    if (free_lists[k]) {
+        free_lists[k]->free_prev = p;
+    }
+    free_lists[k] = p;
+}
+
+/**
+ * 将分区从其大小级对应的空闲链表中摘除
+ * 注意：调用时分区的size必须仍是插入时的大小
+ * @param p 空闲分区指针
+ */
+void free_list_remove(Partition *p) {
+    if (p->free_prev) {
+        p->free_prev->free_next = p->free_next;
+    } else {
+        free_lists[size_class(p->size)] = p->free_next;  // p是链表头
+    }
+    if (p->free_next) {
+        p->free_next->free_prev = p->free_prev;
+    }
+    p->free_prev = NULL;
+    p->free_next = NULL;
+}
+
+/**
+ * 最先适应算法：查找起始地址最低的足够大的空闲分区
+ * 平衡树按(大小, 起始地址)排序，足够大的分区在中序中是一个后缀：从根向下查找下界，
+ * 途经的每个足够大的节点连同其右子树都满足请求，各子树中地址最低的分区已记录在节点上，
+ * 只需比较路径上这些候选者，时间复杂度O(log n)
+ * @param size 请求的内存大小
+ * @return 找到的分区指针，如果没找到返回NULL
+ */
+Partition* first_fit(long long size) {
+    TreeNode *n = size_tree;
+    Partition *first = NULL;  // 当前找到的地址最低的合适分区
+    
+    while (n) {
+        Partition *p = PARTITION_OF(n, size_node);
+        PROFILE_VISIT();
+        if (p->size >= size) {
+            Partition *candidate = p;  // 该节点和右子树中地址最低的分区
+            
+            if (n->right && PARTITION_OF(n->right, size_node)->free_min->start_addr < candidate->start_addr) {
+                candidate = PARTITION_OF(n->right, size_node)->free_min;
+            }
+            if (!first || candidate->start_addr < first->start_addr) {
+                first = candidate;  // 记录地址更低的合适分区
+            }
+            n = n->left;       // 左子树中可能还有足够大、地址更低的分区
+        } else {
+            n = n->right;      // 太小，去右子树找
+        }
+    }
+    
+    return first;  // 返回地址最低的合适分区或NULL
+}
+
+/**
+ * 将空闲分区加入所有空闲分区索引（分级空闲链表和平衡树），并更新空闲统计
+ * @param p 空闲分区指针
+ */
+void free_index_insert(Partition *p) {
+    free_list_insert(p);
+    size_tree = tree_insert(size_tree, &p->size_node, compare_by_size, size_tree_update);
+    
+    free_memory += p->size;
+    free_partition_count++;
+    if (!largest_free_partition ||
+        compare_by_size(&p->size_node, &largest_free_partition->size_node) > 0) {
+        largest_free_partition = p;
+    }
+}
+
+/**
+ * 将分区从所有空闲分区索引中移除，并更新空闲统计
+ * 注意：调用时分区的size和start_addr必须仍是插入时的值
+ * @param p 空闲分区指针
+ */
+void free_index_remove(Partition *p) {
+    free_list_remove(p);
+    size_tree = tree_remove(size_tree, &p->size_node, compare_by_size, size_tree_update);
+    
+    free_memory -= p->size;
+    free_partition_count--;
+    if (p == largest_free_partition) {
+        // 移除的是最大分区时，新的最大分区是平衡树的最右节点，O(log n)
+        TreeNode *n = size_tree;
+        
+        largest_free_partition = NULL;
+        if (n) {
+            while (n->right) {
+                n = n->right;
+            }
+            largest_free_partition = PARTITION_OF(n, size_node);
+        }
+    }
+}
+
+/**
+ * 按(大小, 起始地址)比较两个空闲分区
+ * @return 负数表示a在前，正数表示a在后，0表示相同
+ */
+int compare_by_size(TreeNode *a, TreeNode *b) {
+    Partition *pa = PARTITION_OF(a, size_node);
+    Partition *pb = PARTITION_OF(b, size_node);
+    
+    if (pa->size != pb->size) {
+        return pa->size < pb->size ? -1 : 1;
+    }
+    if (pa->start_addr != pb->start_addr) {
+        return pa->start_addr < pb->start_addr ? -1 : 1;
+    }
+    return 0;
+}
+
+/**
+ * 空闲分区平衡树的附加信息：由左右子树重新计算以该节点为根的子树中起始地址最低的分区
+ * @param n 子节点已更新的树节点
+ */
+void size_tree_update(TreeNode *n) {
+    Partition *p = PARTITION_OF(n, size_node);
+    Partition *min = p;
+    
+    if (n->left && PARTITION_OF(n->left, size_node)->free_min->start_addr < min->start_addr) {
+        min = PARTITION_OF(n->left, size_node)->free_min;
+    }
+    if (n->right && PARTITION_OF(n->right, size_node)->free_min->start_addr < min->start_addr) {
+        min = PARTITION_OF(n->right, size_node)->free_min;
+    }
+    p->free_min = min;
+}
+
+/**
+ * 按起始地址比较两个分区（分区互不重叠，起始地址各不相同）
+ * @return 负数表示a在前，正数表示a在后，0表示相同
+ */
+int compare_by_addr(TreeNode *a, TreeNode *b) {
+    Partition *pa = PARTITION_OF(a, addr_node);
+    Partition *pb = PARTITION_OF(b, addr_node);
+    
+    if (pa->start_addr != pb->start_addr) {
+        return pa->start_addr < pb->start_addr ? -1 : 1;
+    }
+    return 0;
+}
+
+/**
+ * 将分区加入地址索引，新建分区节点时调用
+ */
+void addr_index_insert(Partition *p) {
+    addr_tree = tree_insert(addr_tree, &p->addr_node, compare_by_addr, NULL);
+}
+
+/**
+ * 将分区从地址索引中移除，删除分区节点前调用（起始地址必须仍是插入后的值，
+ * 或只在前后分区之间移动过，使树中的顺序不变）
+ */
+void addr_index_remove(Partition *p) {
+    addr_tree = tree_remove(addr_tree, &p->addr_node, compare_by_addr, NULL);
+}
+
+/**
+ * 获取子树高度，空树高度为0
+ */
+int tree_height(TreeNode *n) {
+    return n ? n->height : 0;
+}
+
+/**
+ * 根据左右子树重新计算节点高度
+ */
+void tree_update_height(TreeNode *n) {
+    int lh = tree_height(n->left);
+    int rh = tree_height(n->right);
+    n->height = (lh > rh ? lh : rh) + 1;
+}
+
+/**
+ * 子节点改变后重新计算节点的高度和附加信息
+ * @param update 由左右子树重新计算节点附加信息的函数，没有附加信息时为NULL
+ */
+void tree_update(TreeNode *n, void (*update)(TreeNode *)) {
+    tree_update_height(n);
+    if (update) {
+        update(n);
+    }
+}
+
+/**
+ * 右旋：左子节点成为新的子树根
+ */
+TreeNode* tree_rotate_right(TreeNode *n, void (*update)(TreeNode *)) {
+    TreeNode *l = n->left;
+    n->left = l->right;
+    l->right = n;
+    tree_update(n, update);
+    tree_update(l, update);
+    return l;
+}
+
+/**
+ * 左旋：右子节点成为新的子树根
+ */
+TreeNode* tree_rotate_left(TreeNode *n, void (*update)(TreeNode *)) {
+    TreeNode *r = n->right;
+    n->right = r->left;
+    r->left = n;
+    tree_update(n, update);
+    tree_update(r, update);
+    return r;
+}
+
+/**
+ * 恢复节点的平衡（左右子树高度差不超过1）
+ * @return 平衡后的子树根
+ */
+TreeNode* tree_rebalance(TreeNode *n, void (*update)(TreeNode *)) {
+    int balance;
+    
+    tree_update(n, update);
+    balance = tree_height(n->left) - tree_height(n->right);
+    
+    if (balance > 1) {                 // 左子树过高
+        if (tree_height(n->left->left) < tree_height(n->left->right)) {
+            n->left = tree_rotate_left(n->left, update);   // 左右型先左旋左子树
+        }
+        return tree_rotate_right(n, update);
+    }
+    if (balance < -1) {                // 右子树过高
+        if (tree_height(n->right->right) < tree_height(n->right->left)) {
+            n->right = tree_rotate_right(n->right, update); // 右左型先右旋右子树
+        }
+        return tree_rotate_left(n, update);
+    }
+    return n;
+}
+
+/**
+ * 向平衡树中插入节点
+ * @param root 子树根
+ * @param node 要插入的节点
+ * @param cmp 节点比较函数
+ * @param update 节点附加信息的更新函数，没有时为NULL
+ * @return 插入后的子树根
+ */
+TreeNode* tree_insert(TreeNode *root, TreeNode *node, int (*cmp)(TreeNode *, TreeNode *), void (*update)(TreeNode *)) {
+    if (!root) {
+        node->left = NULL;
+        node->right = NULL;
+        tree_update(node, update);
+        return node;
+    }
+    
+    if (cmp(node, root) < 0) {
+        root->left = tree_insert(root->left, node, cmp, update);
+    } else {
+        root->right = tree_insert(root->right, node, cmp, update);
+    }
+    return tree_rebalance(root, update);
+}
+
+/**
+ * 从子树中摘除最小节点
+ * @param root 子树根
+ * @param min 输出被摘除的最小节点
+ * @param update 节点附加信息的更新函数，没有时为NULL
+ * @return 摘除后的子树根
+ */
+TreeNode* tree_remove_min(TreeNode *root, TreeNode **min, void (*update)(TreeNode *)) {
+    if (!root->left) {
+        *min = root;
+        return root->right;
+    }
+    root->left = tree_remove_min(root->left, min, update);
+    return tree_rebalance(root, update);
+}
+
+/**
+ * 从平衡树中删除节点
+ * @param root 子树根
+ * @param node 要删除的节点（必须在树中）
+ * @param cmp 节点比较函数
+ * @param update 节点附加信息的更新函数，没有时为NULL
+ * @return 删除后的子树根
+ */
+TreeNode* tree_remove(TreeNode *root, TreeNode *node, int (*cmp)(TreeNode *, TreeNode *), void (*update)(TreeNode *)) {
+    TreeNode *successor = NULL;
+    int c;
+    
+    if (!root) {
+        return NULL;
+    }
+    
+    c = cmp(node, root);
+    if (c < 0) {
+        root->left = tree_remove(root->left, node, cmp, update);
+    } else if (c > 0) {
+        root->right = tree_remove(root->right, node, cmp, update);
+    } else {
+        // 找到要删除的节点，用右子树的最小节点代替它
+        if (!root->left || !root->right) {
+            return root->left ? root->left : root->right;
+        }
+        root->right = tree_remove_min(root->right, &successor, update);
+        successor->left = root->left;
+        successor->right = root->right;
+        root = successor;
+    }
+    return tree_rebalance(root, update);
+}
+
+/**
+ * 由已按比较顺序排好的节点建立平衡树：取中间节点为根，左右两半递归建立，
+ * 每个节点只访问一次，时间复杂度O(n)，比逐个插入少了O(log n)的查找和旋转
+ * @param nodes 按从小到大排序的节点数组
+ * @param n 节点数
+ * @param update 节点附加信息的更新函数，没有时为NULL
+ * @return 树根
+ */
+TreeNode* tree_build_sorted(TreeNode **nodes, long long n, void (*update)(TreeNode *)) {
+    long long mid = n / 2;
+    TreeNode *root;
+
+    if (n <= 0) {
+        return NULL;
+    }
+    root = nodes[mid];
+    root->left = tree_build_sorted(nodes, mid, update);
+    root->right = tree_build_sorted(nodes + mid + 1, n - mid - 1, update);
+    tree_update(root, update);
+    return root;
+}
+
+/**
+ * 由分区链表建立平衡树：链表已按地址排序，中序位置依次取链表中的下一个节点，
+ * 不需要额外的数组
+ * @param cursor 链表中下一个要放入树中的分区，建立过程中向后移动
+ * @param n 子树的节点数
+ * @return 子树根
+ */
+TreeNode* addr_tree_build(Partition **cursor, long long n) {
+    TreeNode *left, *root;
+    
+    if (n <= 0) {
+        return NULL;
+    }
+    left = addr_tree_build(cursor, n / 2);
+    root = &(*cursor)->addr_node;
+    *cursor = (*cursor)->next;
+    root->left = left;
+    root->right = addr_tree_build(cursor, n - n / 2 - 1);
+    tree_update_height(root);
+    return root;
+}
+
+/**
+ * 按分区链表在O(n)时间内重建地址索引，用于一次改动大量节点之后（紧凑、恢复快照、构造测试内存）
+ */
+void addr_index_rebuild() {
+    Partition *cursor = memory_list;
+    long long n = 0;
+    
+    for (Partition *p = memory_list; p; p = p->next) {
+        n++;
+    }
+    addr_tree = addr_tree_build(&cursor, n);
+}
+
+/**
+ * 在平衡树中查找大小不小于size的最小空闲分区，大小相同时取地址最低者
+ * @param size 请求的内存大小
+ * @return 找到的分区指针，如果没找到返回NULL
+ */
+Partition* size_tree_lower_bound(long long size) {
+    TreeNode *n = size_tree;
+    Partition *found = NULL;
+    
+    while (n) {
+        Partition *p = PARTITION_OF(n, size_node);
+        PROFILE_VISIT();
+        if (p->size >= size) {
+            found = p;       // 满足条件，继续在左子树中找更小的
+            n = n->left;
+        } else {
+            n = n->right;    // 太小，去右子树找
+        }
+    }
+    return found;
+}
+
+/**
+ * 最佳适应算法：查找最小的且足够大的空闲分区
+ * 在按(大小, 起始地址)排序的平衡树中查找下界，时间复杂度O(log n)
+ * @param size 请求的内存大小
+ * @return 找到的分区指针，如果没找到返回NULL
+ */
+Partition* best_fit(long long size) {
+    return size_tree_lower_bound(size);
+}
+
+/**
+ * 最坏适应算法：查找剩余空间最大的空闲分区
+ * 取平衡树中最大的大小，再查找该大小中地址最低的分区，时间复杂度O(log n)
+ * @param size 请求的内存大小
+ * @return 找到的分区指针，如果没找到返回NULL
+ */
+Partition* worst_fit(long long size) {
+    Partition *largest = largest_free_partition;  // 平衡树最右节点，由空闲分区索引维护
+    
+    if (!largest) {
+        return NULL;  // 没有空闲分区
+    }
+    
+    if (largest->size < size) {
+        return NULL;  // 最大的空闲分区也不够大
+    }
+    
+    // 多个分区同为最大时，与按地址顺序扫描一致地取地址最低者
+    return size_tree_lower_bound(largest->size);
+}
+
+/**
+ * 循环首次适应算法：从上次分配结束的位置开始按地址顺序查找第一个足够大的空闲分区，
+ * 查到链表尾部后再从链表头绕回到起始位置
+ * @param size 请求的内存大小
+ * @return 找到的分区指针，如果没找到返回NULL
+ */
+Partition* next_fit(long long size) {
+    Partition *start = next_fit_rover ? next_fit_rover : memory_list;  // 查找起点
+    Partition *p = start;
+    
+    if (!start) {
+        return NULL;  // 链表为空
+    }
+    
+    do {
+        PROFILE_VISIT();
+        if (p->status == FREE && p->size >= size) {
+            return p;  // 找到合适分区
+        }
+        p = p->next ? p->next : memory_list;  // 到达链表尾部后绕回链表头
+    } while (p != start);
+    
+    return NULL;  // 绕完一圈都没有找到合适的分区
+}
+
+/**
+ * 判断两个按地址相邻的分区能否合并：都为空闲且物理地址连续
+ * （初始化时各内存段之间留有间隙，链表中相邻的分区不一定连续）
+ * @param a 前一个分区
+ * @param b 后一个分区
+ * @return 1-可以合并，0-不能合并
+ */
+int can_merge(Partition *a, Partition *b) {
+    return a && b &&
+           a->status == FREE && b->status == FREE &&
+           a->start_addr + a->size == b->start_addr;
+}
+
+/**
+ * 把下一个分区并入当前分区，并删除下一个分区的节点
+ * 调用前两者必须满足can_merge
+ * @param p 当前分区
+ */
+void merge_with_next(Partition *p) {
+    free_index_remove(p);             // 大小即将改变，先移出空闲分区索引
+    absorb_next(p);
+    free_index_insert(p);             // 按新大小重新加入空闲分区索引
+}
+
+/**
+ * 把下一个空闲分区并入当前分区：下一个分区移出空闲分区索引并删除节点，
+ * 当前分区的大小增加，但不更新当前分区在空闲分区索引中的位置，由调用者负责
+ * @param p 当前分区，调用前已移出空闲分区索引
+ */
+void absorb_next(Partition *p) {
+    Partition *next = p->next;
+    
+    free_index_remove(next);          // 被合并的分区不再单独存在
+    p->size += next->size;            // 增加当前分区的大小
+    
+    // 从双向链表中移除下一个分区
+    p->next = next->next;
+    if (next->next) {
+        next->next->prev = p;
+    }
+    if (next_fit_rover == next) {
+        next_fit_rover = p;           // 游标指向被合并的节点时，改为指向合并后的分区
+    }
+    addr_index_remove(next);          // 从地址索引中删除
+    pool_free(&partition_pool, next); // 被合并分区的节点还给节点池
+}
+
+/**
+ * 把刚变为空闲的分区与地址相邻的空闲分区合并，只检查前后两个邻居，时间为O(1)
+ * （不计空闲分区索引的更新）
+ * @param p 空闲分区，必须已在空闲分区索引中
+ * @return 合并后的分区
+ */
+Partition* coalesce_partition(Partition *p) {
+    if (can_merge(p, p->next)) {
+        merge_with_next(p);           // 吸收后一个空闲分区
+    }
+    if (can_merge(p->prev, p)) {
+        p = p->prev;
+        merge_with_next(p);           // 被前一个空闲分区吸收
+    }
+    return p;
+}
+
+/**
+ * 合并相邻的空闲分区：对整个链表做一次线性扫描
+ * 连续的一段空闲分区整体并入第一个分区，第一个分区只在开始和结束时各更新一次空闲分区索引
+ * 立即合并时释放内存已经就地合并，这里用于延迟合并的批量扫描和需要整理全部分区的场合
+ */
+void merge_free_partitions() {
+    Partition *current = memory_list;
+    PROFILE_START();
+    
+    while (current && current->next) {
+        if (can_merge(current, current->next)) {
+            free_index_remove(current);
+            while (can_merge(current, current->next)) {
+                absorb_next(current);  // 吸收后继续检查新的下一个分区
+            }
+            free_index_insert(current);
+        }
+        current = current->next;      // 后一个分区不能合并，继续检查下一对
+    }
+    PROFILE_STOP(PROFILE_MERGE);
+}
+
+/**
+ * 计算满足请求大小的最小阶
+ * @param size 请求大小(KB)
+ * @return 阶数k，使得2^k >= size
+ */
+int buddy_order_for(long long size) {
+    int k = 0;
+    
+    while (k < BUDDY_ORDER_COUNT - 1 && (1LL << k) < size) {
+        k++;
+    }
+    return k;
+}
+
+/**
+ * 将空闲块插入其阶对应的空闲链表头部
+ */
+void buddy_free_list_insert(BuddyBlock *b) {
+    b->free_prev = NULL;
+    b->free_next = buddy_free_lists[b->order];
+    if (buddy_free_lists[b->order]) {
+        buddy_free_lists[b->order]->free_prev = b;
+    }
+    buddy_free_lists[b->order] = b;
+    buddy_free_memory += 1LL << b->order;
+    buddy_free_count++;
+}
+
+/**
+ * 将空闲块从其阶对应的空闲链表中摘除
+ */
+void buddy_free_list_remove(BuddyBlock *b) {
+    if (b->free_prev) {
+        b->free_prev->free_next = b->free_next;
+    } else {
+        buddy_free_lists[b->order] = b->free_next;
+    }
+    if (b->free_next) {
+        b->free_next->free_prev = b->free_prev;
+    }
+    b->free_prev = NULL;
+    b->free_next = NULL;
+    buddy_free_memory -= 1LL << b->order;
+    buddy_free_count--;
+}
+
+/**
+ * 创建一个伙伴系统块并插入到地址链表中after之后（after为NULL时追加到链表尾部tail之后）
+ * @return 新块指针
+ */
+BuddyBlock* buddy_new_block(long long start_addr, int order, BuddyBlock *after) {
+    BuddyBlock *b = (BuddyBlock *)pool_alloc(&buddy_pool);
+    if (!b) {
+        printf("内存分配失败！\n");
+        exit(1);
+    }
+    
+    b->start_addr = start_addr;
+    b->order = order;
+    b->status = FREE;
+    b->request_size = 0;
+    b->process_id = FREE_PROCESS_ID;
+    b->free_prev = NULL;
+    b->free_next = NULL;
+    b->owner_next = NULL;
+    
+    // 插入地址链表
+    b->prev = after;
+    if (after) {
+        b->next = after->next;
+        if (after->next) {
+            after->next->prev = b;
+        }
+        after->next = b;
+    } else {
+        b->next = buddy_list;
+        if (buddy_list) {
+            buddy_list->prev = b;
+        }
+        buddy_list = b;
+    }
+    return b;
+}
+
+/**
+ * 释放伙伴系统的全部块
+ */
+void buddy_clear() {
+    pool_release_all(&buddy_pool);  // 全部块节点都在节点池中，一次性释放
+    buddy_list = NULL;
+    for (int k = 0; k < BUDDY_ORDER_COUNT; k++) {
+        buddy_free_lists[k] = NULL;
+    }
+    buddy_free_memory = 0;
+    buddy_free_count = 0;
+    buddy_internal = 0;
+}
+
+/**
+ * 按当前内存分区布局初始化伙伴系统：
+ * 把每个连续的内存段切成按自身大小对齐的2的幂大小的块，
+ * 这样伙伴地址（起始地址异或块大小）总是落在同一段内或间隙中
+ */
+void buddy_initialize() {
+    BuddyBlock *tail = NULL;  // 地址链表尾部
+    
+    buddy_clear();
+    
+    for (Partition *p = memory_list; p; p = p->next) {
+        long long addr = p->start_addr;
+        long long end = p->start_addr + p->size;
+        
+        while (addr < end) {
+            int k = 0;
+            // 找到起始地址对齐且不越过段尾的最大阶
+            while (k + 1 < BUDDY_ORDER_COUNT &&
+                   addr % (1LL << (k + 1)) == 0 &&
+                   addr + (1LL << (k + 1)) <= end) {
+                k++;
+            }
+            tail = buddy_new_block(addr, k, tail);
+            buddy_free_list_insert(tail);
+            addr += 1LL << k;
+        }
+    }
+}
+
+/**
+ * 伙伴系统分配内存：取不小于所需阶的最小非空空闲链表中的块，逐级对半分裂
+ * 2^k大小的块起始地址总是2^k的倍数，对齐要求只需把所需阶提高到不小于对齐大小
+ * @param req 资源请求结构体
+ * @param alignment 起始地址的对齐大小(KB)，必须是2的幂
+ * @return 分配结果：1-成功，0-失败
+ */
+int buddy_allocate(Request req, long long alignment) {
+    int k = buddy_order_for(req.size > alignment ? req.size : alignment);  // 需要的阶
+    int j = k;
+    BuddyBlock *b;
+    ProcessEntry *e;
+    
+    // 查找有空闲块的最小阶
+    while (j < BUDDY_ORDER_COUNT && !buddy_free_lists[j]) {
+        j++;
+    }
+    if (j == BUDDY_ORDER_COUNT) {
+        return 0;  // 没有足够大的空闲块
+    }
+    
+    b = buddy_free_lists[j];
+    buddy_free_list_remove(b);
+    
+    // 逐级分裂，每次把后一半作为空闲伙伴放回对应阶的空闲链表
+    while (j > k) {
+        j--;
+        b->order = j;
+        buddy_free_list_insert(buddy_new_block(b->start_addr + (1LL << j), j, b));
+    }
+    
+    b->status = BUSY;
+    b->request_size = req.size;
+    buddy_internal += (1LL << k) - req.size;
+    
+    // 记入进程索引
+    e = process_lookup(req.process_name, 1);
+    b->process_id = e->process_id;
+    b->owner_next = e->buddy_blocks;
+    e->buddy_blocks = b;
+    return 1;
+}
+
+/**
+ * 释放一个伙伴系统块，并与空闲的伙伴逐级合并
+ * 伙伴地址 = 起始地址 XOR 块大小；伙伴若整块空闲，一定是地址链表中紧邻的块
+ * @param b 要释放的块
+ * @return 合并后的块
+ */
+BuddyBlock* buddy_free_block(BuddyBlock *b) {
+    buddy_internal -= (1LL << b->order) - b->request_size;
+    b->status = FREE;
+    b->request_size = 0;
+    b->process_id = FREE_PROCESS_ID;
+    b->owner_next = NULL;
+    
+    while (b->order + 1 < BUDDY_ORDER_COUNT) {
+        long long buddy_addr = b->start_addr ^ (1LL << b->order);  // 伙伴的起始地址
+        BuddyBlock *buddy = buddy_addr > b->start_addr ? b->next : b->prev;
+        
+        // 伙伴必须存在、空闲且阶相同（否则伙伴已被分裂或位于间隙中）
+        if (!buddy || buddy->start_addr != buddy_addr ||
+            buddy->status != FREE || buddy->order != b->order) {
+            break;
+        }
+        
+        buddy_free_list_remove(buddy);
+        if (buddy->start_addr < b->start_addr) {  // 保留地址较低的块
+            BuddyBlock *t = b;
+            b = buddy;
+            buddy = t;
+        }
+        
+        // 从地址链表中删除地址较高的块
+        b->next = buddy->next;
+        if (buddy->next) {
+            buddy->next->prev = b;
+        }
+        pool_free(&buddy_pool, buddy);
+        b->order++;
+    }
+    
+    buddy_free_list_insert(b);
+    return b;
+}
+
+/**
+ * 伙伴系统释放内存：释放进程占用的全部块
+ * @param process_name 要释放内存的进程名
+ * @return 释放结果：1-成功，0-失败（未找到进程）
+ */
+int buddy_release(char *process_name) {
+    ProcessEntry *e = process_lookup(process_name, 0);  // 在进程索引中查找该进程
+    BuddyBlock *b, *next;
+    
+    if (!e || !e->buddy_blocks) {
+        return 0;
+    }
+    
+    // 只有空闲块会被合并删除，进程占用的其余块在合并过程中保持不变
+    for (b = e->buddy_blocks; b; b = next) {
+        next = b->owner_next;
+        buddy_free_block(b);
+    }
+    e->buddy_blocks = NULL;
+    process_remove_if_empty(e);
+    return 1;
+}
+
+/**
+ * 伙伴系统调整进程内存的大小，进程占用多个块时调整最近分配的那个块
+ * 所需阶不变时只修改请求大小；缩小时逐级把后一半分裂出来作为空闲块；
+ * 扩大时若块是伙伴中地址较低的一个且各级伙伴整块空闲，就地逐级吸收伙伴；
+ * 都不行时才另外分配一个块并把数据搬过去，再释放原来的块
+ * @param process_name 进程名
+ * @param new_size 新的大小(KB)
+ * @return 调整结果：1-成功，0-失败（未找到进程或没有足够的空间，原块保持不变）
+ */
+int buddy_realloc(const char *process_name, long long new_size) {
+    ProcessEntry *e = process_lookup(process_name, 0);
+    BuddyBlock *b, *c;
+    int k = buddy_order_for(new_size);  // 需要的阶
+    int j;
+    Request req;
+    
+    if (!e || !e->buddy_blocks) {
+        return 0;
+    }
+    b = e->buddy_blocks;  // 新分配的块挂在进程块链表头部
+    
+    // 检查能否就地扩大到k阶：从b往后，第j阶的伙伴必须紧跟着出现且整块空闲
+    c = b->next;
+    for (j = b->order; j < k; j++) {
+        if (b->start_addr & (1LL << j) || !c || c->start_addr != b->start_addr + (1LL << j) ||
+            c->status != FREE || c->order != j) {
+            break;
+        }
+        c = c->next;
+    }
+    
+    if (j >= k) {
+        buddy_internal -= (1LL << b->order) - b->request_size;
+        
+        // 缩小：逐级把后一半作为空闲块分裂出来，它的伙伴就是仍被占用的前一半，不会再合并
+        while (b->order > k) {
+            b->order--;
+            buddy_free_list_insert(buddy_new_block(b->start_addr + (1LL << b->order), b->order, b));
+        }
+        
+        // 扩大：逐级吸收紧跟在后面的空闲伙伴
+        while (b->order < k) {
+            c = b->next;
+            buddy_free_list_remove(c);
+            b->next = c->next;
+            if (c->next) {
+                c->next->prev = b;
+            }
+            pool_free(&buddy_pool, c);
+            b->order++;
+        }
+        
+        b->request_size = new_size;
+        buddy_internal += (1LL << k) - new_size;
+        return 1;
+    }
+    
+    // 无法就地扩大：先另外分配，成功后再释放原来的块，新块挂在链表头部、原块是其后一个
+    strcpy(req.process_name, e->process_name);
+    req.size = new_size;
+    if (!buddy_allocate(req, 1)) {
+        return 0;
+    }
+    realloc_moved += b->request_size;
+    e->buddy_blocks->owner_next = b->owner_next;
+    buddy_free_block(b);
+    return 1;
+}
+
+/**
+ * 显示伙伴系统内存使用情况
+ */
+void display_buddy_memory() {
+    BuddyBlock *b = buddy_list;
+    int i = 1;
+    
+    printf("\n当前内存使用情况（伙伴系统）：\n");
+    printf("-------------------------------------------------------------\n");
+    printf("| 序号 | 起始地址 | 大小(KB) | 请求(KB) | 状态 | 进程名     |\n");
+    printf("-------------------------------------------------------------\n");
+    
+    while (b) {
+        printf("| %-4d | %-8lld | %-8lld | %-8lld | %-4s | %-10s |\n",
+               i++,
+               b->start_addr,
+               1LL << b->order,
+               b->request_size,
+               b->status == FREE ? "空闲" : "已分配",
+               process_name_of(b->process_id));
+        b = b->next;
+    }
+    
+    printf("-------------------------------------------------------------\n");
+    display_fragmentation();
+}
+
+/**
+ * 求64位字中最低的置位位置，x不能为0
+ */
+int bitmap_ctz(unsigned long long x) {
+#ifdef __GNUC__
+    return __builtin_ctzll(x);
+#else
+    int n = 0;
+    
+    while (!(x & 1)) {
+        x >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+/**
+ * 求64位字中最高的置位之上的0的个数，x不能为0
+ */
+int bitmap_clz(unsigned long long x) {
+#ifdef __GNUC__
+    return __builtin_clzll(x);
+#else
+    int n = 0;
+    
+    while (!(x >> 63)) {
+        x <<= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+/**
+ * 统计一个字内的空闲情况
+ * @param x 粒度位图的字
+ * @param prefix 输出开头的连续空闲块数
+ * @param suffix 输出末尾的连续空闲块数
+ * @param longest 输出最长的连续空闲块数
+ */
+void bitmap_word_runs(unsigned long long x, long long *prefix, long long *suffix, long long *longest) {
+    int best = 0, bit = 0;
+    
+    if (x == 0 || x == ~0ULL) {
+        *prefix = *suffix = *longest = x ? 64 : 0;
+        return;
+    }
+    *prefix = bitmap_ctz(~x);
+    *suffix = bitmap_clz(~x);
+    
+    // 逐段跳过0和1，每段两次位扫描
+    while (bit < 64) {
+        unsigned long long rest = x >> bit;
+        int ones;
+        
+        if (rest == 0) {
+            break;
+        }
+        bit += bitmap_ctz(rest);
+        ones = bitmap_ctz(~(x >> bit));  // x >> bit的高位补0，结果不超过64 - bit
+        if (ones > best) {
+            best = ones;
+        }
+        bit += ones;
+    }
+    *longest = best;
+}
+
+/**
+ * 取第level层节点的第j个子节点的统计：第0层节点的子节点是粒度位图的字，
+ * 更高层节点的子节点是下一层的节点；超出范围的子节点视为全部已占用
+ * @return 子节点覆盖的粒度块数
+ */
+long long bitmap_child_runs(int level, long long j, long long *prefix, long long *suffix, long long *longest) {
+    if (level == 0) {
+        bitmap_word_runs(j < bitmap_words ? bitmap_free_bits[j] : 0, prefix, suffix, longest);
+        return 64;
+    }
+    if (j < bitmap_summary.nodes[level - 1]) {
+        *prefix = bitmap_summary.prefix[level - 1][j];
+        *suffix = bitmap_summary.suffix[level - 1][j];
+        *longest = bitmap_summary.longest[level - 1][j];
+    } else {
+        *prefix = *suffix = *longest = 0;
+    }
+    return 64LL << (BITMAP_FANOUT_SHIFT * level);
+}
+
+/**
+ * 由各子节点重新计算第level层第i个节点的开头、末尾和最长连续空闲块数
+ */
+void bitmap_summary_update(int level, long long i) {
+    long long prefix = 0, run = 0, longest = 0;
+    int open = 1;  // 目前为止的子节点是否全部空闲
+    
+    for (long long j = i * BITMAP_FANOUT; j < (i + 1) * BITMAP_FANOUT; j++) {
+        long long p, s, l;
+        long long length = bitmap_child_runs(level, j, &p, &s, &l);
+        
+        if (open) {
+            prefix += p;
+            open = p == length;
+        }
+        if (p == length) {
+            run += length;  // 整个子节点空闲，连续空闲段继续延长
+        } else {
+            if (run + p > longest) {
+                longest = run + p;
+            }
+            run = s;
+        }
+        if (l > longest) {
+            longest = l;
+        }
+        if (run > longest) {
+            longest = run;
+        }
+    }
+    bitmap_summary.prefix[level][i] = prefix;
+    bitmap_summary.suffix[level][i] = run;
+    bitmap_summary.longest[level][i] = longest;
+}
+
+/**
+ * 为摘要申请各层的数组，每层节点数是下一层的1/BITMAP_FANOUT，直到只剩一个根节点
+ * @param words 粒度位图的字数
+ */
+void bitmap_summary_init(long long words) {
+    long long entries = words;
+    
+    bitmap_summary.levels = 0;
+    do {
+        long long nodes = entries > BITMAP_FANOUT ? (entries + BITMAP_FANOUT - 1) / BITMAP_FANOUT : 1;
+        int l = bitmap_summary.levels;
+        
+        if (l == BITMAP_MAX_LEVELS) {
+            printf("位图过大！\n");
+            exit(1);
+        }
+        bitmap_summary.prefix[l] = (long long *)calloc(nodes, sizeof(long long));
+        bitmap_summary.suffix[l] = (long long *)calloc(nodes, sizeof(long long));
+        bitmap_summary.longest[l] = (long long *)calloc(nodes, sizeof(long long));
+        if (!bitmap_summary.prefix[l] || !bitmap_summary.suffix[l] || !bitmap_summary.longest[l]) {
+            printf("内存分配失败！\n");
+            exit(1);
+        }
+        bitmap_summary.nodes[l] = nodes;
+        bitmap_summary.levels++;
+        entries = nodes;
+    } while (entries > 1);
+}
+
+/**
+ * 释放摘要的各层数组
+ */
+void bitmap_summary_free() {
+    for (int l = 0; l < bitmap_summary.levels; l++) {
+        free(bitmap_summary.prefix[l]);
+        free(bitmap_summary.suffix[l]);
+        free(bitmap_summary.longest[l]);
+        bitmap_summary.prefix[l] = NULL;
+        bitmap_summary.suffix[l] = NULL;
+        bitmap_summary.longest[l] = NULL;
+    }
+    bitmap_summary.levels = 0;
+}
+
+/**
+ * 把一段粒度块标记为空闲或已占用：按字改写位图，再逐层更新覆盖这些字的摘要节点。
+ * 完全落在改动范围内的节点整个空闲或整个已占用，直接赋值；
+ * 只有范围两端的节点需要由子节点重新计算，每层至多两个
+ * @param start 起始粒度块号
+ * @param count 粒度块数
+ * @param free 1-标记为空闲，0-标记为已占用
+ */
+void bitmap_set_range(long long start, long long count, int free) {
+    long long end = start + count;
+    long long first = start >> 6, last = (end - 1) >> 6;  // 改动的第一个和最后一个字
+    long long w = first;
+    
+    while (w <= last) {
+        int lo = w == first ? (int)(start & 63) : 0;
+        int hi = w == last ? (int)(((end - 1) & 63) + 1) : 64;
+        unsigned long long mask = (hi == 64 ? ~0ULL : (1ULL << hi) - 1) & (~0ULL << lo);
+        
+        // 中间的整字一次写完
+        if (mask == ~0ULL && w < last) {
+            memset(&bitmap_free_bits[w], free ? 0xFF : 0, sizeof(unsigned long long) * (last - w));
+            w = last;
+            continue;
+        }
+        if (free) {
+            bitmap_free_bits[w] |= mask;
+        } else {
+            bitmap_free_bits[w] &= ~mask;
+        }
+        w++;
+    }
+    
+    for (int l = 0; l < bitmap_summary.levels; l++) {
+        long long length = 64LL << (BITMAP_FANOUT_SHIFT * (l + 1));  // 本层每个节点覆盖的粒度块数
+        
+        first >>= BITMAP_FANOUT_SHIFT;
+        last >>= BITMAP_FANOUT_SHIFT;
+        for (long long i = first; i <= last; i++) {
+            if (i > first && i < last) {
+                // 中间的节点完全在改动范围内
+                long long value = free ? length : 0;
+                bitmap_summary.prefix[l][i] = value;
+                bitmap_summary.suffix[l][i] = value;
+                bitmap_summary.longest[l][i] = value;
+            } else {
+                bitmap_summary_update(l, i);
+            }
+        }
+    }
+}
+
+/**
+ * 判断粒度块是否空闲，超出位图范围的视为已占用
+ */
+int bitmap_is_free(long long i) {
+    return i >= 0 && i < bitmap_granules && (bitmap_free_bits[i >> 6] >> (i & 63) & 1);
+}
+
+/**
+ * 判断一段粒度块是否全部空闲，按字比较
+ */
+int bitmap_range_free(long long start, long long count) {
+    long long end = start + count;
+    
+    if (end > bitmap_granules) {
+        return 0;
+    }
+    while (start < end) {
+        long long w = start >> 6;
+        int lo = (int)(start & 63);
+        int hi = end - (w << 6) < 64 ? (int)(end - (w << 6)) : 64;
+        unsigned long long mask = (hi == 64 ? ~0ULL : (1ULL << hi) - 1) & (~0ULL << lo);
+        
+        if ((bitmap_free_bits[w] & mask) != mask) {
+            return 0;
+        }
+        start = (w + 1) << 6;
+    }
+    return 1;
+}
+
+/**
+ * 占用一段空闲粒度块并更新统计，这段粒度块必须位于同一个连续空闲段内
+ */
+void bitmap_take(long long start, long long count) {
+    int left = bitmap_is_free(start - 1);
+    int right = bitmap_is_free(start + count);
+    
+    bitmap_set_range(start, count, 0);
+    bitmap_free_granules -= count;
+    bitmap_hole_count += left && right ? 1 : (!left && !right ? -1 : 0);  // 空闲段被分成两段或整段用完
+}
+
+/**
+ * 归还一段已占用的粒度块并更新统计，与相邻的空闲段自然连成一段，不需要单独合并
+ */
+void bitmap_give(long long start, long long count) {
+    int left = bitmap_is_free(start - 1);
+    int right = bitmap_is_free(start + count);
+    
+    bitmap_set_range(start, count, 1);
+    bitmap_free_granules += count;
+    bitmap_hole_count += left && right ? -1 : (!left && !right ? 1 : 0);  // 两个空闲段连成一段或新出现一段
+}
+
+/**
+ * 查找地址最低的、至少count个粒度块长的连续空闲段。
+ * 从根节点向下，每层在BITMAP_FANOUT个子节点中从左到右累计跨子节点的空闲段：
+ * 跨到当前子节点开头的空闲段已经够长就直接返回，否则进入第一个内部最长空闲段够长的子节点，
+ * 时间为O(BITMAP_FANOUT × 层数)，与空闲段的个数无关
+ * @param count 粒度块数
+ * @return 起始粒度块号，没找到返回-1
+ */
+long long bitmap_find_run(long long count) {
+    int l = bitmap_summary.levels - 1;
+    long long node = 0;      // 当前所在的节点，最后是含有该空闲段的字
+    unsigned long long y;
+    
+    if (bitmap_summary.longest[l][0] < count) {
+        return -1;  // 根节点记录了全局最长的空闲段
+    }
+    
+    for (; l >= 0; l--) {
+        long long carry = 0;  // 延续到当前子节点开头之前的连续空闲块数
+        
+        for (long long j = node * BITMAP_FANOUT; ; j++) {
+            long long p, s, longest;
+            long long length = bitmap_child_runs(l, j, &p, &s, &longest);
+            
+            if (carry + p >= count) {
+                return j * length - carry;
+            }
+            if (longest >= count) {
+                node = j;
+                break;
+            }
+            carry = p == length ? carry + length : s;
+        }
+    }
+    
+    // 空闲段在一个字内部：y的第i位为1表示第i位起的count位全为1
+    y = bitmap_free_bits[node];
+    for (long long k = 1; k < count; ) {
+        long long step = k < count - k ? k : count - k;
+        y &= y >> step;
+        k += step;
+    }
+    return node * 64 + bitmap_ctz(y);
+}
+
+/**
+ * 释放位图分配引擎的全部块和位图
+ */
+void bitmap_clear() {
+    pool_release_all(&bitmap_pool);
+    free(bitmap_free_bits);
+    bitmap_free_bits = NULL;
+    bitmap_summary_free();
+    bitmap_granules = 0;
+    bitmap_words = 0;
+    bitmap_free_granules = 0;
+    bitmap_hole_count = 0;
+    bitmap_internal = 0;
+}
+
+/**
+ * 按当前内存分区布局初始化位图分配引擎：
+ * 选取使粒度块数不超过BITMAP_MAX_GRANULES的最小的2的幂作为粒度，
+ * 各内存段内完整的粒度块标记为空闲，段间间隙和段边缘不足一个粒度的部分视为已占用
+ */
+void bitmap_initialize() {
+    long long span = 0;  // 最后一个内存段的结束地址
+    
+    bitmap_clear();
+    
+    for (Partition *p = memory_list; p; p = p->next) {
+        if (p->start_addr + p->size > span) {
+            span = p->start_addr + p->size;
+        }
+    }
+    bitmap_granule = bitmap_granule_for(span);
+    bitmap_granules = span / bitmap_granule;
+    bitmap_words = (bitmap_granules + 63) / 64;
+    
+    // 至少申请一个字，内存为空时摘要也有效
+    bitmap_free_bits = (unsigned long long *)calloc(bitmap_words + 1, sizeof(unsigned long long));
+    if (!bitmap_free_bits) {
+        printf("内存分配失败！\n");
+        exit(1);
+    }
+    bitmap_summary_init(bitmap_words);  // 初始全部已占用，摘要各项都是0
+    
+    // 地址相连的分区合成一个内存段，每段只标记一次
+    for (Partition *p = memory_list; p; ) {
+        long long start = p->start_addr;
+        long long end = p->start_addr + p->size;
+        long long first, last;
+        
+        for (p = p->next; p && p->start_addr == end; p = p->next) {
+            end += p->size;
+        }
+        first = (start + bitmap_granule - 1) / bitmap_granule;
+        last = end / bitmap_granule;
+        if (first < last) {
+            bitmap_give(first, last - first);
+        }
+    }
+}
+
+/**
+ * 计算覆盖span(KB)内存所用的粒度大小：从1KB起加倍，直到粒度块数不超过BITMAP_MAX_GRANULES
+ * @param span 最后一个内存段的结束地址
+ * @return 粒度大小(KB)
+ */
+long long bitmap_granule_for(long long span) {
+    long long granule = 1;
+    
+    while (span / granule > BITMAP_MAX_GRANULES) {
+        granule <<= 1;
+    }
+    return granule;
+}
+
+/**
+ * 位图分配引擎分配内存：请求大小向上取整到粒度的倍数，占用地址最低的足够长的连续空闲段
+ * 对齐大于粒度时多查找对齐所需的粒度块数，占用其中对齐的部分，开头跳过的部分仍然空闲
+ * @param req 资源请求结构体
+ * @param alignment 起始地址的对齐大小(KB)，必须是2的幂
+ * @return 分配结果：1-成功，0-失败
+ */
+int bitmap_allocate(Request req, long long alignment) {
+    long long count = (req.size + bitmap_granule - 1) / bitmap_granule;  // 需要的粒度块数
+    long long step = alignment > bitmap_granule ? alignment / bitmap_granule : 1;  // 起始块号须是step的倍数
+    long long start;
+    BitmapBlock *b;
+    ProcessEntry *e;
+    
+    if (count <= 0) {
+        return 0;
+    }
+    start = bitmap_find_run(count + step - 1);
+    if (start < 0) {
+        return 0;
+    }
+    start = (start + step - 1) & ~(step - 1);
+    
+    b = (BitmapBlock *)pool_alloc(&bitmap_pool);
+    if (!b) {
+        printf("内存分配失败！\n");
+        return 0;
+    }
+    bitmap_take(start, count);
+    bitmap_internal += count * bitmap_granule - req.size;
+    
+    // 记入进程索引
+    e = process_lookup(req.process_name, 1);
+    b->start = start;
+    b->count = count;
+    b->request_size = req.size;
+    b->process_id = e->process_id;
+    b->owner_next = e->bitmap_blocks;
+    e->bitmap_blocks = b;
+    return 1;
+}
+
+/**
+ * 位图分配引擎释放内存：把进程占用的各段粒度块标记为空闲，
+ * 与相邻空闲段的合并由位图自然完成，每段只改动它覆盖的字
+ * @param process_name 要释放内存的进程名
+ * @return 释放结果：1-成功，0-失败（未找到进程）
+ */
+int bitmap_release(char *process_name) {
+    ProcessEntry *e = process_lookup(process_name, 0);
+    BitmapBlock *b, *next;
+    
+    if (!e || !e->bitmap_blocks) {
+        return 0;
+    }
+    
+    for (b = e->bitmap_blocks; b; b = next) {
+        next = b->owner_next;
+        bitmap_give(b->start, b->count);
+        bitmap_internal -= b->count * bitmap_granule - b->request_size;
+        pool_free(&bitmap_pool, b);
+    }
+    e->bitmap_blocks = NULL;
+    process_remove_if_empty(e);
+    return 1;
+}
+
+/**
+ * 位图分配引擎调整进程内存的大小，进程占用多个块时调整最近分配的那个块
+ * 缩小时归还尾部的粒度块；扩大时若紧跟其后的粒度块都空闲就地占用；
+ * 都不行时才另外分配一段并把数据搬过去，再释放原来的块
+ * @param process_name 进程名
+ * @param new_size 新的大小(KB)
+ * @return 调整结果：1-成功，0-失败（未找到进程或没有足够的空间，原块保持不变）
+ */
+int bitmap_realloc(const char *process_name, long long new_size) {
+    ProcessEntry *e = process_lookup(process_name, 0);
+    long long count = (new_size + bitmap_granule - 1) / bitmap_granule;
+    BitmapBlock *b;
+    Request req;
+    
+    if (!e || !e->bitmap_blocks) {
+        return 0;
+    }
+    b = e->bitmap_blocks;  // 新分配的块挂在进程块链表头部
+    
+    if (count < b->count) {
+        bitmap_give(b->start + count, b->count - count);
+    } else if (count > b->count) {
+        if (!bitmap_range_free(b->start + b->count, count - b->count)) {
+            // 无法就地扩大：先另外分配，成功后再释放原来的块，新块挂在链表头部、原块是其后一个
+            strcpy(req.process_name, e->process_name);
+            req.size = new_size;
+            if (!bitmap_allocate(req, 1)) {
+                return 0;
+            }
+            realloc_moved += b->request_size;
+            e->bitmap_blocks->owner_next = b->owner_next;
+            bitmap_give(b->start, b->count);
+            bitmap_internal -= b->count * bitmap_granule - b->request_size;
+            pool_free(&bitmap_pool, b);
+            return 1;
+        }
+        bitmap_take(b->start + b->count, count - b->count);
+    }
+    
+    bitmap_internal += count * bitmap_granule - new_size - (b->count * bitmap_granule - b->request_size);
+    b->count = count;
+    b->request_size = new_size;
+    return 1;
+}
+
+/**
+ * 按起始粒度块号比较两个位图块，显示时排序用
+ */
+int compare_bitmap_blocks(const void *a, const void *b) {
+    const BitmapBlock *x = *(const BitmapBlock * const *)a;
+    const BitmapBlock *y = *(const BitmapBlock * const *)b;
+    
+    return x->start < y->start ? -1 : (x->start > y->start ? 1 : 0);
+}
+
+/**
+ * 显示位图分配引擎的内存使用情况：已分配块按地址排序，与位图中的连续空闲段交替列出
+ */
+void display_bitmap_memory() {
+    long long n = 0, k = 0, pos = 0;
+    int i = 1;
+    BitmapBlock **blocks;
+    
+    for (int id = 1; id <= process_id_count; id++) {
+        for (BitmapBlock *b = process_by_id[id]->bitmap_blocks; b; b = b->owner_next) {
+            n++;
+        }
+    }
+    blocks = (BitmapBlock **)malloc(sizeof(BitmapBlock *) * (n + 1));
+    if (!blocks) {
+        printf("内存分配失败！\n");
+        return;
+    }
+    for (int id = 1; id <= process_id_count; id++) {
+        for (BitmapBlock *b = process_by_id[id]->bitmap_blocks; b; b = b->owner_next) {
+            blocks[k++] = b;
+        }
+    }
+    qsort(blocks, n, sizeof(BitmapBlock *), compare_bitmap_blocks);
+    
+    printf("\n当前内存使用情况（位图分配，粒度%lldKB）：\n", bitmap_granule);
+    printf("-------------------------------------------------------------\n");
+    printf("| 序号 | 起始地址 | 大小(KB) | 请求(KB) | 状态 | 进程名     |\n");
+    printf("-------------------------------------------------------------\n");
+    
+    k = 0;
+    while (pos < bitmap_granules) {
+        if (k < n && blocks[k]->start == pos) {
+            BitmapBlock *b = blocks[k++];
+            printf("| %-4d | %-8lld | %-8lld | %-8lld | %-4s | %-10s |\n",
+                   i++, b->start * bitmap_granule, b->count * bitmap_granule, b->request_size,
+                   "已分配", process_name_of(b->process_id));
+            pos = b->start + b->count;
+        } else if (bitmap_is_free(pos)) {
+            long long end = pos;
+            while (bitmap_is_free(end)) {
+                end++;
+            }
+            printf("| %-4d | %-8lld | %-8lld | %-8d | %-4s | %-10s |\n",
+                   i++, pos * bitmap_granule, (end - pos) * bitmap_granule, 0, "空闲", process_name_of(FREE_PROCESS_ID));
+            pos = end;
+        } else {
+            pos++;  // 段间间隙
+        }
+    }
+    
+    printf("-------------------------------------------------------------\n");
+    free(blocks);
+    display_fragmentation();
+}
+
+/**
+ * 计算大小所在的TLSF(一级, 二级)：小于TLSF_SL_COUNT的大小在第0个一级中按大小逐个分级，
+ * 更大的按最高位分一级，最高位之后的TLSF_SL_SHIFT位分二级
+ * @param size 大小(KB)，必须大于0
+ * @param fl 输出一级下标
+ * @param sl 输出二级下标
+ */
+void tlsf_mapping(long long size, int *fl, int *sl) {
+    int msb;
+    
+    if (size < TLSF_SL_COUNT) {
+        *fl = 0;
+        *sl = (int)size;
+        return;
+    }
+    msb = 63 - bitmap_clz((unsigned long long)size);
+    *fl = msb - TLSF_SL_SHIFT + 1;
+    *sl = (int)(size >> (msb - TLSF_SL_SHIFT)) - TLSF_SL_COUNT;
+}
+
+/**
+ * 将空闲块插入其所在(一级, 二级)空闲链表的头部，并置位两级位图；
+ * 记录的最大空闲块仍有效时，新块更大就替换它
+ */
+void tlsf_free_list_insert(TlsfBlock *b) {
+    int fl, sl;
+    
+    if (tlsf_free_count == 0 || (tlsf_largest_free && b->size > tlsf_largest_free->size)) {
+        tlsf_largest_free = b;
+    }
+    tlsf_mapping(b->size, &fl, &sl);
+    b->free_prev = NULL;
+    b->free_next = tlsf_free_lists[fl][sl];
+    if (tlsf_free_lists[fl][sl]) {
+        tlsf_free_lists[fl][sl]->free_prev = b;
+    }
+    tlsf_free_lists[fl][sl] = b;
+    tlsf_fl_bitmap |= 1ULL << fl;
+    tlsf_sl_bitmap[fl] |= 1U << sl;
+    tlsf_free_memory += b->size;
+    tlsf_free_count++;
+}
+
+/**
+ * 将空闲块从其所在的空闲链表中摘除，链表变空时清除两级位图中对应的位；
+ * 摘除的是最大的空闲块时只把记录置为失效，不在分配和合并的路径上查找，保持O(1)
+ */
+void tlsf_free_list_remove(TlsfBlock *b) {
+    int fl, sl;
+    
+    tlsf_mapping(b->size, &fl, &sl);
+    if (b->free_prev) {
+        b->free_prev->free_next = b->free_next;
+    } else {
+        tlsf_free_lists[fl][sl] = b->free_next;
+        if (!b->free_next) {
+            tlsf_sl_bitmap[fl] &= ~(1U << sl);
+            if (!tlsf_sl_bitmap[fl]) {
+                tlsf_fl_bitmap &= ~(1ULL << fl);
+            }
+        }
+    }
+    if (b->free_next) {
+        b->free_next->free_prev = b->free_prev;
+    }
+    b->free_prev = NULL;
+    b->free_next = NULL;
+    tlsf_free_memory -= b->size;
+    tlsf_free_count--;
+    if (b == tlsf_largest_free) {
+        tlsf_largest_free = NULL;
+    }
+}
+
+/**
+ * 在最高的非空(一级, 二级)空闲链表中查找最大的空闲块，更低的链表中的块都比它小；
+ * 只在查询指标时记录的最大空闲块失效后调用
+ * @return 最大的空闲块，没有空闲块时返回NULL
+ */
+TlsfBlock* tlsf_find_largest() {
+    TlsfBlock *largest = NULL;
+    int fl, sl;
+    
+    if (!tlsf_fl_bitmap) {
+        return NULL;
+    }
+    fl = 63 - bitmap_clz(tlsf_fl_bitmap);
+    sl = 63 - bitmap_clz(tlsf_sl_bitmap[fl]);
+    for (TlsfBlock *b = tlsf_free_lists[fl][sl]; b; b = b->free_next) {
+        if (!largest || b->size > largest->size) {
+            largest = b;
+        }
+    }
+    return largest;
+}
+
+/**
+ * 创建一个空闲的TLSF块并插入到地址链表中after之后（after为NULL时插入到链表头部）
+ * 新块不在空闲链表中，由调用者决定是否加入
+ * @return 新块指针
+ */
+TlsfBlock* tlsf_new_block(long long start_addr, long long size, TlsfBlock *after) {
+    TlsfBlock *b = (TlsfBlock *)pool_alloc(&tlsf_pool);
+    if (!b) {
+        printf("内存分配失败！\n");
+        exit(1);
+    }
+    
+    b->start_addr = start_addr;
+    b->size = size;
+    b->status = FREE;
+    b->process_id = FREE_PROCESS_ID;
+    b->free_prev = NULL;
+    b->free_next = NULL;
+    b->owner_next = NULL;
+    
+    // 插入地址链表
+    b->prev = after;
+    if (after) {
+        b->next = after->next;
+        if (after->next) {
+            after->next->prev = b;
+        }
+        after->next = b;
+    } else {
+        b->next = tlsf_list;
+        if (tlsf_list) {
+            tlsf_list->prev = b;
+        }
+        tlsf_list = b;
+    }
+    return b;
+}
+
+/**
+ * 判断两个相邻的TLSF块能否合并：都空闲且地址连续（内存段之间的间隙两侧不能合并）
+ */
+int tlsf_can_merge(TlsfBlock *a, TlsfBlock *b) {
+    return a && b && a->status == FREE && b->status == FREE &&
+           a->start_addr + a->size == b->start_addr;
+}
+
+/**
+ * 把下一个块并入当前块，并删除下一个块的节点；两者都不能在空闲链表中
+ */
+void tlsf_absorb_next(TlsfBlock *b) {
+    TlsfBlock *next = b->next;
+    
+    b->size += next->size;
+    b->next = next->next;
+    if (next->next) {
+        next->next->prev = b;
+    }
+    pool_free(&tlsf_pool, next);
+}
+
+/**
+ * 释放TLSF分配引擎的全部块
+ */
+void tlsf_clear() {
+    pool_release_all(&tlsf_pool);  // 全部块节点都在节点池中，一次性释放
+    tlsf_list = NULL;
+    memset(tlsf_free_lists, 0, sizeof(tlsf_free_lists));
+    memset(tlsf_sl_bitmap, 0, sizeof(tlsf_sl_bitmap));
+    tlsf_fl_bitmap = 0;
+    tlsf_free_memory = 0;
+    tlsf_free_count = 0;
+    tlsf_largest_free = NULL;
+}
+
+/**
+ * 按当前内存分区布局初始化TLSF分配引擎：每个连续的内存段成为一个空闲块
+ */
+void tlsf_initialize() {
+    TlsfBlock *tail = NULL;  // 地址链表尾部
+    
+    tlsf_clear();
+    
+    // 地址相连的分区合成一个内存段
+    for (Partition *p = memory_list; p; ) {
+        long long start = p->start_addr;
+        long long end = p->start_addr + p->size;
+        
+        for (p = p->next; p && p->start_addr == end; p = p->next) {
+            end += p->size;
+        }
+        tail = tlsf_new_block(start, end - start, tail);
+        tlsf_free_list_insert(tail);
+    }
+}
+
+/**
+ * 由一级/二级位图在O(1)时间内找到足够大的空闲块（good-fit）：
+ * 请求大小先向上取整到所在二级的上界，这样取整后所在级及更高级中的任何块都足够大，
+ * 只需在二级位图和一级位图中各找一次最低的置位；
+ * 都没有时再看请求本身所在级链表的第一个块是否恰好够大
+ * @param size 请求大小(KB)
+ * @return 找到的空闲块（仍在空闲链表中），没有返回NULL
+ */
+TlsfBlock* tlsf_find_block(long long size) {
+    long long rounded = size;
+    unsigned int sl_map;
+    unsigned long long fl_map;
+    int fl, sl;
+    
+    if (size >= TLSF_SL_COUNT) {
+        rounded += (1LL << (63 - bitmap_clz((unsigned long long)size) - TLSF_SL_SHIFT)) - 1;
+    }
+    tlsf_mapping(rounded, &fl, &sl);
+    
+    // 同一个一级中不低于sl的二级，其次是更高的一级中最低的非空二级
+    sl_map = tlsf_sl_bitmap[fl] & (~0U << sl);
+    if (!sl_map) {
+        fl_map = fl + 1 < TLSF_FL_COUNT ? tlsf_fl_bitmap & (~0ULL << (fl + 1)) : 0;
+        if (!fl_map) {
+            TlsfBlock *b;
+            
+            tlsf_mapping(size, &fl, &sl);
+            b = tlsf_free_lists[fl][sl];
+            return b && b->size >= size ? b : NULL;
+        }
+        fl = bitmap_ctz(fl_map);
+        sl_map = tlsf_sl_bitmap[fl];
+    }
+    sl = bitmap_ctz(sl_map);
+    return tlsf_free_lists[fl][sl];
+}
+
+/**
+ * TLSF分配引擎分配内存：由两级位图取一个足够大的空闲块，按请求大小精确分割，
+ * 剩余部分作为空闲块放回对应的空闲链表。查找、分割都是O(1)的，与空闲块数无关
+ * 对齐时多查找对齐所需的大小，开头的填充部分分割出来作为空闲块
+ * @param req 资源请求结构体
+ * @param alignment 起始地址的对齐大小(KB)，必须是2的幂
+ * @return 分配结果：1-成功，0-失败
+ */
+int tlsf_allocate(Request req, long long alignment) {
+    TlsfBlock *b;
+    ProcessEntry *e;
+    long long padding;
+    
+    if (req.size <= 0 || req.size > tlsf_free_memory) {
+        return 0;
+    }
+    b = tlsf_find_block(req.size + alignment - 1);
+    if (!b) {
+        return 0;
+    }
+    tlsf_free_list_remove(b);
+    
+    // 空闲块的前后邻居都不是空闲块（释放时立即合并），分割出的填充和剩余部分不需要再合并
+    padding = align_up(b->start_addr, alignment) - b->start_addr;
+    if (padding > 0) {
+        TlsfBlock *head = b;
+        b = tlsf_new_block(head->start_addr + padding, head->size - padding, head);
+        head->size = padding;
+        tlsf_free_list_insert(head);
+    }
+    if (b->size > req.size) {
+        tlsf_free_list_insert(tlsf_new_block(b->start_addr + req.size, b->size - req.size, b));
+        b->size = req.size;
+    }
+    
+    // 记入进程索引
+    e = process_lookup(req.process_name, 1);
+    b->status = BUSY;
+    b->process_id = e->process_id;
+    b->owner_next = e->tlsf_blocks;
+    e->tlsf_blocks = b;
+    return 1;
+}
+
+/**
+ * 释放一个TLSF块，并立即与地址相邻的空闲块合并，只检查前后两个邻居
+ * @param b 要释放的块
+ * @return 合并后的块（已在空闲链表中）
+ */
+TlsfBlock* tlsf_free_block(TlsfBlock *b) {
+    b->status = FREE;
+    b->process_id = FREE_PROCESS_ID;
+    b->owner_next = NULL;
+    
+    if (tlsf_can_merge(b, b->next)) {
+        tlsf_free_list_remove(b->next);
+        tlsf_absorb_next(b);
+    }
+    if (tlsf_can_merge(b->prev, b)) {
+        b = b->prev;
+        tlsf_free_list_remove(b);
+        tlsf_absorb_next(b);
+    }
+    tlsf_free_list_insert(b);
+    return b;
+}
+
+/**
+ * TLSF分配引擎释放内存：释放进程占用的全部块
+ * @param process_name 要释放内存的进程名
+ * @return 释放结果：1-成功，0-失败（未找到进程）
+ */
+int tlsf_release(char *process_name) {
+    ProcessEntry *e = process_lookup(process_name, 0);
+    TlsfBlock *b, *next;
+    
+    if (!e || !e->tlsf_blocks) {
+        return 0;
+    }
+    
+    // 只有空闲块会被合并删除，进程占用的其余块在合并过程中保持不变
+    for (b = e->tlsf_blocks; b; b = next) {
+        next = b->owner_next;
+        tlsf_free_block(b);
+    }
+    e->tlsf_blocks = NULL;
+    process_remove_if_empty(e);
+    return 1;
+}
+
+/**
+ * TLSF分配引擎调整进程内存的大小，进程占用多个块时调整最近分配的那个块
+ * 缩小时尾部分割出来作为空闲块，与后面的空闲块合并；
+ * 扩大时若后面紧邻的空闲块足够大，就地吸收其开头部分；
+ * 都不行时才另外分配一个块并把数据搬过去，再释放原来的块
+ * @param process_name 进程名
+ * @param new_size 新的大小(KB)
+ * @return 调整结果：1-成功，0-失败（未找到进程或没有足够的空间，原块保持不变）
+ */
+int tlsf_realloc(const char *process_name, long long new_size) {
+    ProcessEntry *e = process_lookup(process_name, 0);
+    TlsfBlock *b, *next;
+    Request req;
+    
+    if (!e || !e->tlsf_blocks) {
+        return 0;
+    }
+    b = e->tlsf_blocks;  // 新分配的块挂在进程块链表头部
+    next = b->next;
+    
+    if (new_size < b->size) {
+        TlsfBlock *tail = tlsf_new_block(b->start_addr + new_size, b->size - new_size, b);
+        
+        b->size = new_size;
+        if (tlsf_can_merge(tail, tail->next)) {
+            tlsf_free_list_remove(tail->next);
+            tlsf_absorb_next(tail);
+        }
+        tlsf_free_list_insert(tail);
+        return 1;
+    }
+    if (new_size == b->size) {
+        return 1;
+    }
+    
+    // 扩大：后面紧邻的空闲块足够大时就地扩展
+    if (next && next->status == FREE && b->start_addr + b->size == next->start_addr &&
+        next->size >= new_size - b->size) {
+        long long grow = new_size - b->size;
+        
+        tlsf_free_list_remove(next);
+        if (next->size == grow) {
+            tlsf_absorb_next(b);
+        } else {
+            next->start_addr += grow;
+            next->size -= grow;
+            b->size = new_size;
+            tlsf_free_list_insert(next);
+        }
+        return 1;
+    }
+    
+    // 无法就地扩大：先另外分配，成功后再释放原来的块，新块挂在链表头部、原块是其后一个
+    strcpy(req.process_name, e->process_name);
+    req.size = new_size;
+    if (!tlsf_allocate(req, 1)) {
+        return 0;
+    }
+    realloc_moved += b->size;
+    e->tlsf_blocks->owner_next = b->owner_next;
+    tlsf_free_block(b);
+    return 1;
+}
+
+/**
+ * 显示TLSF分配引擎的内存使用情况
+ */
+void display_tlsf_memory() {
+    TlsfBlock *b = tlsf_list;
+    int i = 1;
+    
+    printf("\n当前内存使用情况（TLSF）：\n");
+    printf("--------------------------------------------------\n");
+    printf("| 序号 | 起始地址 | 大小(KB) | 状态 | 进程名     |\n");
+    printf("--------------------------------------------------\n");
+    
+    while (b) {
+        printf("| %-4d | %-8lld | %-8lld | %-4s | %-10s |\n",
+               i++,
+               b->start_addr,
+               b->size,
+               b->status == FREE ? "空闲" : "已分配",
+               process_name_of(b->process_id));
+        b = b->next;
+    }
+    
+    printf("--------------------------------------------------\n");
+    display_fragmentation();
+}
+
+/**
+ * 查询当前分配引擎的占用和碎片指标。所有计数器都在空闲索引插入/删除时增量维护，
+ * 查询是O(1)的，可以在每次操作后调用而不影响分配和释放的开销；
+ * 只有TLSF在上次查询后摘除了最大空闲块时，才扫描一次最高的非空空闲链表
+ * @param m 输出的指标
+ */
+void query_metrics(MemoryMetrics *m) {
+    if (algorithm == BUDDY_SYSTEM) {
+        int k = BUDDY_ORDER_COUNT - 1;
+        
+        // 最大空闲块是最高的非空阶，阶数固定，视为常数时间
+        while (k >= 0 && !buddy_free_lists[k]) {
+            k--;
+        }
+        m->free_total = buddy_free_memory;
+        m->hole_count = buddy_free_count;
+        m->largest_free = k >= 0 ? 1LL << k : 0;
+        m->internal = buddy_internal;
+    } else if (algorithm == BITMAP_SYSTEM) {
+        // 摘要的根节点记录了最长的连续空闲段
+        m->free_total = bitmap_free_granules * bitmap_granule;
+        m->hole_count = bitmap_hole_count;
+        m->largest_free = bitmap_summary.longest[bitmap_summary.levels - 1][0] * bitmap_granule;
+        m->internal = bitmap_internal;
+    } else if (algorithm == TLSF_SYSTEM) {
+        // 记录的最大空闲块被摘除后，才在最高的非空链表中重新查找一次
+        if (!tlsf_largest_free && tlsf_free_count > 0) {
+            tlsf_largest_free = tlsf_find_largest();
+        }
+        m->free_total = tlsf_free_memory;
+        m->hole_count = tlsf_free_count;
+        m->largest_free = tlsf_largest_free ? tlsf_largest_free->size : 0;
+        m->internal = 0;  // 按请求大小精确分割，没有内部碎片
+    } else {
+        // 可变分区按请求大小精确分割，没有内部碎片
+        m->free_total = free_memory;
+        m->hole_count = free_partition_count;
+        m->largest_free = largest_free_partition ? largest_free_partition->size : 0;
+        m->internal = 0;
+    }
+    
+    // 各分配引擎使用相同的内存段布局（位图中段边缘不足一个粒度的部分计入已分配）
+    m->busy_total = managed_memory - m->free_total;
+    m->external = external_fragmentation(m->free_total, m->largest_free);
+}
+
+/**
+ * 统计当前分配引擎的碎片情况
+ * @param free_total 输出空闲内存总量(KB)
+ * @param largest_free 输出最大空闲块大小(KB)
+ * @param internal 输出内部碎片总量(KB)，即已分配块中未被请求使用的部分
+ */
+void collect_fragmentation(long long *free_total, long long *largest_free, long long *internal) {
+    MemoryMetrics m;
+    
+    query_metrics(&m);
+    *free_total = m.free_total;
+    *largest_free = m.largest_free;
+    *internal = m.internal;
+}
+
+/**
+ * 计算外部碎片率：1 - 最大空闲块 / 空闲总量
+ * @return 外部碎片率（0~1），没有空闲内存时为0
+ */
+double external_fragmentation(long long free_total, long long largest_free) {
+    return free_total > 0 ? 1.0 - (double)largest_free / free_total : 0.0;
+}
+
+/**
+ * 显示内部碎片和外部碎片统计
+ */
+void display_fragmentation() {
+    MemoryMetrics m;
+    
+    query_metrics(&m);
+    printf("空闲总量: %lldKB  已分配: %lldKB  空闲块: %lld个  最大空闲块: %lldKB  外部碎片率: %.1f%%  内部碎片: %lldKB\n",
+           m.free_total, m.busy_total, m.hole_count, m.largest_free,
+           m.external * 100, m.internal);
+}
+
+/**
+ * 打印功能菜单
+ */
+void print_menu() {
+    const char *alg_name = algorithm_name(algorithm);  // 当前选择的内存分配算法的名称
+    
+    // 打印菜单内容
+    printf("\n======= 动态分区存储管理模拟 =======\n");
+    printf("当前分配算法: %s\n", alg_name);
+    printf("内存布局种子: %u\n", layout_seed);
+    printf("1. 显示内存使用情况\n");
+    printf("2. 分配内存\n");
+    printf("3. 释放内存\n");
+    printf("4. 切换分配算法\n");
+    printf("5. 重置内存\n");
+    printf("6. 退出程序\n");
+    printf("7. 紧凑设置（当前: %s）\n", compaction_enabled ? "分配失败时自动紧凑" : "关闭");
+    printf("8. 保存/加载快照\n");
+    printf("9. 调整进程内存大小\n");
+    printf("10. 前端缓存设置（当前: %s）\n", front_cache_enabled ? "开启" : "关闭");
+    printf("11. 按地址查询/释放\n");
+    printf("12. 延迟合并设置（当前: %s）\n", lazy_coalesce_enabled ? "开启" : "关闭");
+    printf("===================================\n");
+}
+
+/**
+ * 获取分配算法的中文名称
+ * @param alg 算法标识
+ * @return 算法名称
+ */
+const char* algorithm_name(int alg) {
+    switch (alg) {
+        case FIRST_FIT: return "最先适应";
+        case BEST_FIT:  return "最佳适应";
+        case WORST_FIT: return "最坏适应";
+        case NEXT_FIT:  return "循环首次适应";
+        case BUDDY_SYSTEM: return "伙伴系统";
+        case BITMAP_SYSTEM: return "位图分配";
+        case TLSF_SYSTEM: return "TLSF";
+        default:        return "最先适应";  // 无效值按默认的最先适应处理
+    }
+}
+
+/**
+ * 清屏函数
+ */
+void clear_screen() {
+    system("cls");  // Windows系统使用cls命令清屏
+}
+
+/**
+ * 设置文本颜色
+ * @param color 颜色代码
+ */
+void set_text_color(int color) {                        //接受一个 int color 参数，表示要设置的文本颜色       
+    HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);  // 获取控制台句柄
+    SetConsoleTextAttribute(hConsole, color);           // 设置文本颜色属性
+    //调用 SetConsoleTextAttribute 函数来设置控制台文本的颜色。hConsole 是获取的控制台句柄，color 是传入的颜色代码
+} 
+
+/**
+ * 重置文本颜色为默认值
+ */
+void reset_text_color() {
+    HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);  // 获取控制台句柄，为之后的 SetConsoleTextAttribute 函数提供控制台句柄
+    SetConsoleTextAttribute(hConsole, 7);               // 设置为默认的白色(7)
+} 
+
+/**
+ * 获取高精度计时器的当前时间
+ * @return 当前时间（秒）
+ */
+double get_time_seconds() {
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);  // 计时器频率（每秒计数）
+    QueryPerformanceCounter(&counter);      // 当前计数
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+}
+
+/**
+ * 处理命令行参数，以非交互方式运行
+ * @return 程序退出码；-1表示只设置了初始状态（种子或快照），继续进入交互界面
+ */
+int run_command_line(int argc, char *argv[]) {
+    const char *trace_path = NULL;  // 要回放的轨迹文件
+    const char *generate_path = NULL;  // 要生成的二进制轨迹文件
+    const char *save_path = NULL;   // 保存快照的文件
+    unsigned int seed = 1;          // 初始内存布局的随机数种子
+    int suite = 0;                  // 是否运行负载分布测试
+    int distribution = -1;          // 负载分布，-1表示全部
+    int ops = 200000;               // 负载分布测试的分配次数
+    int mean_lifetime = 256;        // 进程平均存活的分配次数
+    long long mean_size = 0;        // 平均请求大小(KB)，0表示按内存大小自动确定
+    int memory_given = 0;           // 是否指定了内存大小
+    GeneratorSpec spec = {100000, 1000.0, DIST_EXPONENTIAL, 0, DIST_EXPONENTIAL, 256.0, 4, LOCALITY_MIXED, 64, 1024, 1};
+    int lifetime_given = 0;         // 是否指定了平均存活时间
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--bench-fit") == 0) {
+            benchmark_fit_lookup();
+            return 0;
+        } else if (strcmp(argv[i], "--bench-policies") == 0) {
+            benchmark_policies();
+            return 0;
+        } else if (strcmp(argv[i], "--bench-batch") == 0) {
+            benchmark_batch();
+            return 0;
+        } else if (strcmp(argv[i], "--bench-table") == 0) {
+            benchmark_table();
+            return 0;
+        } else if (strcmp(argv[i], "--bench-simd") == 0) {
+            benchmark_simd();
+            return 0;
+        } else if (strcmp(argv[i], "--bench-snapshot") == 0) {
+            benchmark_snapshot();
+            return 0;
+        } else if (strcmp(argv[i], "--bench-cache") == 0) {
+            benchmark_front_cache();
+            return 0;
+        } else if (strcmp(argv[i], "--bench-lazy") == 0) {
+            benchmark_lazy_coalesce();
+            return 0;
+        } else if (strcmp(argv[i], "--bench-profile") == 0) {
+#ifdef ALLOC_PROFILE
+            benchmark_profile();
+            return 0;
+#else
+            printf("未启用延迟直方图，请在编译时定义ALLOC_PROFILE（gcc -DALLOC_PROFILE）\n");
+            return 1;
+#endif
+        } else if (strcmp(argv[i], "--bench-suite") == 0) {
+            suite = 1;
+        } else if (strcmp(argv[i], "--distribution") == 0 && i + 1 < argc) {
+            distribution = parse_distribution(argv[++i]);
+            if (distribution < 0) {
+                printf("无效的负载分布: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--ops") == 0 && i + 1 < argc) {
+            ops = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--lifetime") == 0 && i + 1 < argc) {
+            mean_lifetime = atoi(argv[++i]);
+            lifetime_given = 1;
+        } else if (strcmp(argv[i], "--mean-size") == 0 && i + 1 < argc) {
+            mean_size = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (strcmp(argv[i], "--generate") == 0 && i + 1 < argc) {
+            generate_path = argv[++i];
+        } else if (strcmp(argv[i], "--processes") == 0 && i + 1 < argc) {
+            spec.processes = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            spec.arrival_rate = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--lifetime-distribution") == 0 && i + 1 < argc) {
+            spec.lifetime_distribution = parse_distribution(argv[++i]);
+            if (spec.lifetime_distribution < 0) {
+                printf("无效的存活时间分布: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--refs") == 0 && i + 1 < argc) {
+            spec.refs_per_arrival = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--locality") == 0 && i + 1 < argc) {
+            spec.locality = parse_locality(argv[++i]);
+            if (spec.locality < 0) {
+                printf("无效的局部性模型: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--pages") == 0 && i + 1 < argc) {
+            spec.page_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--page-size") == 0 && i + 1 < argc) {
+            spec.page_size = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--algorithm") == 0 && i + 1 < argc) {
+            algorithm = parse_algorithm(argv[++i]);
+            if (!algorithm) {
+                printf("无效的分配算法: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--memory") == 0 && i + 1 < argc) {
+            total_memory_size = atoll(argv[++i]);
+            if (total_memory_size <= 0) {
+                printf("无效的内存大小: %s\n", argv[i]);
+                return 1;
+            }
+            memory_given = 1;
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+            spec.seed = seed;
+            layout_seed = seed;
+            layout_seed_fixed = 1;
+        } else if (strcmp(argv[i], "--load-snapshot") == 0 && i + 1 < argc) {
+            start_snapshot = argv[++i];
+        } else if (strcmp(argv[i], "--save-snapshot") == 0 && i + 1 < argc) {
+            save_path = argv[++i];
+        } else if (strcmp(argv[i], "--compact") == 0) {
+            compaction_enabled = 1;
+        } else if (strcmp(argv[i], "--front-cache") == 0) {
+            front_cache_enabled = 1;
+        } else if (strcmp(argv[i], "--lazy-coalesce") == 0 && i + 1 < argc) {
+            lazy_coalesce_threshold = atoi(argv[++i]);
+            if (lazy_coalesce_threshold <= 0) {
+                printf("无效的扫描阈值: %s\n", argv[i]);
+                return 1;
+            }
+            lazy_coalesce_enabled = 1;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    if (generate_path) {
+        // 默认平均请求大小使平均占用约为总内存的70%（平均存活进程数约为平均存活时间）
+        if (distribution >= 0) {
+            spec.size_distribution = distribution;
+        }
+        if (lifetime_given) {
+            spec.mean_lifetime = mean_lifetime;
+        }
+        spec.mean_size = mean_size > 0 ? mean_size : (long long)(total_memory_size * 0.7 / spec.mean_lifetime);
+        if (spec.mean_size < 1) {
+            spec.mean_size = 1;
+        }
+        if (spec.processes <= 0 || spec.arrival_rate <= 0 || spec.mean_lifetime <= 0 || spec.refs_per_arrival < 0 ||
+            spec.page_count <= 0 || spec.page_size <= 0 || mean_size < 0) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        if (!generate_trace(generate_path, &spec)) {
+            return 1;
+        }
+        printf("已生成轨迹文件: %s（%lld个进程，平均请求%lldKB）\n", generate_path, spec.processes, spec.mean_size);
+        return 0;
+    }
+    if (trace_path) {
+        return replay_trace(trace_path, seed, save_path);
+    }
+    if (suite) {
+        if (ops <= 0 || mean_lifetime <= 0 || mean_size < 0) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        if (!memory_given) {
+            total_memory_size = 64 * 1024;  // 默认64MB
+        }
+        benchmark_suite(distribution, ops, mean_lifetime, mean_size);
+        return 0;
+    }
+    
+    // 只指定了种子或快照：生成或加载初始状态，保存快照后退出，否则进入交互界面
+    if (layout_seed_fixed || start_snapshot) {
+        if (start_snapshot) {
+            if (!load_snapshot(start_snapshot)) {
+                return 1;
+            }
+        } else {
+            initialize_memory();
+        }
+        if (save_path) {
+            if (!save_snapshot(save_path)) {
+                return 1;
+            }
+            printf("已保存快照: %s\n", save_path);
+            clear_memory_list();
+            return 0;
+        }
+        return -1;
+    }
+    
+    print_usage(argv[0]);
+    return 1;
+}
+
+/**
+ * 打印命令行用法
+ * @param program 程序名
+ */
+void print_usage(const char *program) {
+    printf("用法: %s [--bench-fit | --bench-policies | --bench-batch]\n", program);
+    printf("      %s --trace 文件 [--algorithm 算法] [--memory KB] [--seed 种子] [--compact] [--front-cache] [--lazy-coalesce 次数] [--load-snapshot 文件] [--save-snapshot 文件]\n", program);
+    printf("      %s --bench-suite [--distribution 分布] [--memory KB] [--ops 次数] [--lifetime 次数] [--mean-size KB] [--compact] [--front-cache] [--lazy-coalesce 次数] [--load-snapshot 文件]\n", program);
+    printf("      %s --generate 文件 [--processes 个数] [--rate 每秒] [--distribution 分布] [--mean-size KB] [--memory KB] [--lifetime 间隔数] [--lifetime-distribution 分布] [--refs 次数] [--locality 模型] [--pages 页数] [--page-size 字节] [--seed 种子]\n", program);
+    printf("      %s [--memory KB] [--seed 种子 | --load-snapshot 文件] [--save-snapshot 文件]\n", program);
+    printf("  --bench-fit       测试最佳/最坏适应查找延迟随空闲分区数的变化\n");
+    printf("  --bench-policies  在同一负载下比较各分配算法的吞吐量和碎片\n");
+    printf("  --bench-batch     比较批量分配与逐个分配的接纳率和碎片\n");
+    printf("  --trace           无交互地回放分配/释放轨迹文件，每行为\"时间戳 进程名 大小\"，大小为0表示释放，进程名为\"@地址\"时按地址释放；\n"
+           "                    也可以是--generate生成的二进制轨迹，其中的页面访问记录被跳过\n");
+    printf("  --algorithm       分配算法：first/best/worst/next/buddy/bitmap/tlsf 或编号1~7，默认first\n");
+    printf("  --memory          总内存大小(KB)，默认1024\n");
+    printf("  --seed            初始内存布局的随机数种子，轨迹回放默认1；单独使用时以该种子进入交互界面\n");
+    printf("  --load-snapshot   从快照文件恢复初始状态（轨迹回放、负载测试或交互界面）\n");
+    printf("  --save-snapshot   把轨迹回放结束时或按种子生成的状态保存为快照文件\n");
+    printf("  --bench-snapshot  测试快照的保存/恢复耗时，并验证恢复后的行为与原状态一致\n");
+    printf("  --compact         分配失败时自动紧凑内存\n");
+    printf("  --front-cache     启用前端缓存：释放的小分区暂存起来，直接分配给下一个同样大小的请求\n");
+    printf("  --bench-cache     比较启用前端缓存前后的吞吐量、命中率和碎片\n");
+    printf("  --lazy-coalesce   延迟合并：释放时不合并，累计指定次数的释放或分配失败时扫描合并一次\n");
+    printf("  --bench-lazy      比较立即合并与不同扫描阈值的延迟合并的吞吐量和碎片\n");
+    printf("  --bench-profile   比较各算法的延迟分位数和查找访问的节点数随内存大小的变化（需用-DALLOC_PROFILE编译）\n");
+    printf("  --bench-table     比较数组分区表与链表的首次适应查找延迟和分配吞吐量\n");
+    printf("  --bench-simd      比较标量/SSE2/AVX2查找内核在打包空闲大小数组上的速度\n");
+    printf("  --bench-suite     在多种请求大小分布下比较各分配算法的吞吐量、延迟、失败率和外部碎片\n");
+    printf("  --distribution    负载分布：uniform/exponential/bimodal/powerlaw，默认全部\n");
+    printf("  --ops             分配次数，默认200000\n");
+    printf("  --lifetime        进程平均存活的分配次数（指数分布），默认256\n");
+    printf("  --mean-size       平均请求大小(KB)，默认使平均占用约为总内存的70%%（测试时--memory默认65536，最大可到64GB）\n");
+    printf("  --generate        生成合成负载的二进制轨迹：进程按泊松过程到达，申请一次内存，存活到期后释放，期间访问页面\n");
+    printf("  --processes       生成的进程数，默认100000\n");
+    printf("  --rate            进程到达率（每秒），默认1000\n");
+    printf("  --lifetime-distribution  存活时间分布：uniform/exponential/bimodal/powerlaw，默认exponential；\n"
+           "                    生成轨迹时--lifetime为平均存活的到达间隔数，--distribution为请求大小分布（默认exponential）\n");
+    printf("  --refs            每次到达后一个存活进程连续访问的页面数，默认4，0表示不生成页面访问\n");
+    printf("  --locality        页面访问的局部性模型：workingset/loop/sequential/mixed，默认mixed（每个进程随机选择）\n");
+    printf("  --pages           页号范围，默认64（与请求式分页程序的页表大小相同）\n");
+    printf("  --page-size       页面大小（字节），默认1024\n");
+}
+
+/**
+ * 把算法名称或编号解析为算法标识
+ * @param text 算法名称（first/best/worst/next/buddy/bitmap/tlsf）或编号（1~7）
+ * @return 算法标识，无效时返回0
+ */
+int parse_algorithm(const char *text) {
+    const char *names[] = {"first", "best", "worst", "next", "buddy", "bitmap", "tlsf"};
+    int number = atoi(text);
+    
+    if (number >= FIRST_FIT && number <= TLSF_SYSTEM) {
+        return number;
+    }
+    for (int i = 0; i < (int)(sizeof(names) / sizeof(names[0])); i++) {
+        if (strcmp(text, names[i]) == 0) {
+            return FIRST_FIT + i;
+        }
+    }
+    return 0;
+}
+
+/**
+ * 把分布名称解析为分布类型
+ * @param text 分布名称（uniform/exponential/bimodal/powerlaw）
+ * @return 分布类型（DIST_*），无效时返回-1
+ */
+int parse_distribution(const char *text) {
+    const char *names[DIST_COUNT] = {"uniform", "exponential", "bimodal", "powerlaw"};
+    
+    for (int i = 0; i < DIST_COUNT; i++) {
+        if (strcmp(text, names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * 把局部性模型名称解析为模型类型
+ * @param text 模型名称（workingset/loop/sequential/mixed）
+ * @return 模型类型（LOCALITY_*），无效时返回-1
+ */
+int parse_locality(const char *text) {
+    const char *names[LOCALITY_COUNT + 1] = {"workingset", "loop", "sequential", "mixed"};
+    
+    for (int i = 0; i <= LOCALITY_COUNT; i++) {
+        if (strcmp(text, names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * 打开轨迹文件：以TRACE_MAGIC开头的是二进制轨迹，映射到内存后按记录读取，否则按文本轨迹逐行读取
+ * @param r 轨迹读取器
+ * @param path 轨迹文件路径
+ * @return 1-成功，0-失败
+ */
+int trace_open(TraceReader *r, const char *path) {
+    char magic[8] = {0};
+    LARGE_INTEGER file_size;
+    const char *view;
+    
+    memset(r, 0, sizeof(*r));
+    r->fp = fopen(path, "rb");
+    if (!r->fp) {
+        printf("无法打开轨迹文件: %s\n", path);
+        return 0;
+    }
+    if (fread(magic, 1, sizeof(magic), r->fp) != sizeof(magic) ||
+        memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0) {
+        rewind(r->fp);  // 文本轨迹
+        return 1;
+    }
+    fclose(r->fp);
+    r->fp = NULL;
+    
+    // 二进制轨迹：整个文件映射到内存，记录按下标直接读取
+    r->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (r->file == INVALID_HANDLE_VALUE) {
+        printf("无法打开轨迹文件: %s\n", path);
+        return 0;
+    }
+    if (!GetFileSizeEx(r->file, &file_size) || file_size.QuadPart < (long long)sizeof(TraceHeader)) {
+        printf("不是有效的轨迹文件: %s\n", path);
+        CloseHandle(r->file);
+        return 0;
+    }
+    r->mapping = CreateFileMappingA(r->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    view = r->mapping ? (const char *)MapViewOfFile(r->mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!view) {
+        printf("无法映射轨迹文件: %s\n", path);
+        if (r->mapping) {
+            CloseHandle(r->mapping);
+        }
+        CloseHandle(r->file);
+        return 0;
+    }
+    
+    r->header = (const TraceHeader *)view;
+    r->records = (const TraceRecord *)(view + sizeof(TraceHeader));
+    if (r->header->version != TRACE_VERSION || r->header->record_count < 0 ||
+        r->header->record_count > (file_size.QuadPart - (long long)sizeof(TraceHeader)) / (long long)sizeof(TraceRecord)) {
+        printf("轨迹文件版本不符或已损坏: %s\n", path);
+        trace_close(r);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * 读取下一个分配或释放事件，二进制轨迹中的页面访问记录跳过并计数
+ * @param r 轨迹读取器
+ * @param timestamp 输出的事件时间
+ * @param req 输出的请求，大小为0表示释放
+ * @return 1-读到事件，0-轨迹结束，-1-格式错误
+ */
+int trace_next(TraceReader *r, double *timestamp, Request *req) {
+    char line[256];
+    
+    if (r->fp) {
+        while (fgets(line, sizeof(line), r->fp)) {
+            r->line_number++;
+            if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') {
+                continue;  // 跳过注释和空行
+            }
+            if (sscanf(line, "%lf %19s %lld", timestamp, req->process_name, &req->size) != 3) {
+                printf("轨迹文件第%lld行格式错误: %s", r->line_number, line);
+                return -1;
+            }
+            return 1;
+        }
+        return 0;
+    }
+    
+    while (r->next < r->header->record_count) {
+        const TraceRecord *rec = &r->records[r->next++];
+        
+        if (rec->type == TRACE_ACCESS) {
+            r->skipped++;  // 页面访问由请求式分页程序回放
+            continue;
+        }
+        if ((rec->type != TRACE_ALLOC && rec->type != TRACE_FREE) ||
+            (rec->type == TRACE_ALLOC && rec->data.size <= 0)) {
+            printf("轨迹文件第%lld条记录格式错误\n", r->next);
+            return -1;
+        }
+        *timestamp = rec->time;
+        sprintf(req->process_name, "P%u", rec->process_id);
+        req->size = rec->type == TRACE_ALLOC ? rec->data.size : 0;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * 关闭轨迹文件，二进制轨迹解除映射
+ */
+void trace_close(TraceReader *r) {
+    if (r->fp) {
+        fclose(r->fp);
+        r->fp = NULL;
+    }
+    if (r->header) {
+        UnmapViewOfFile(r->header);
+        CloseHandle(r->mapping);
+        CloseHandle(r->file);
+        r->header = NULL;
+    }
+}
+
+/**
+ * 无交互地回放分配/释放轨迹文件：逐个读取事件并调用allocate_memory/release_memory，
+ * 不显示内存状态，最后输出吞吐量、失败次数和碎片统计
+ * 文本轨迹每行为"时间戳 进程名 大小"，大小大于0表示分配，等于0表示释放该进程的全部内存，
+ * 进程名写成"@地址"且大小为0时按地址释放从该地址开始的分区（release_at），以#开头的行为注释；
+ * 也可以是generate_trace生成的二进制轨迹，其中的页面访问记录跳过
+ * 指定了初始状态快照（start_snapshot）时从快照开始回放，否则按种子生成初始布局
+ * @param path 轨迹文件路径
+ * @param seed 初始内存布局的随机数种子
+ * @param save_path 回放结束后把分配器状态保存为快照的文件，NULL表示不保存
+ * @return 程序退出码
+ */
+int replay_trace(const char *path, unsigned int seed, const char *save_path) {
+    TraceReader reader;
+    double timestamp;
+    Request req;
+    int status;
+    long long allocs = 0, frees = 0;          // 分配和释放事件数
+    long long alloc_failures = 0, free_failures = 0;  // 失败次数
+    double first_time = 0, last_time = 0;     // 轨迹中的首末时间戳
+    double elapsed = 0;                       // 分配器调用的累计耗时（秒）
+    long long free_total, largest_free, internal;
+    
+    if (!trace_open(&reader, path)) {
+        return 1;
+    }
+    
+    if (start_snapshot) {
+        if (!load_snapshot(start_snapshot)) {
+            trace_close(&reader);
+            return 1;
+        }
+    } else {
+        build_memory_segments(seed);
+    }
+    
+    while ((status = trace_next(&reader, &timestamp, &req)) > 0) {
+        double start;
+        
+        if (allocs + frees == 0) {
+            first_time = timestamp;
+        }
+        last_time = timestamp;
+        
+        start = get_time_seconds();
+        if (req.size > 0) {
+            allocs++;
+            if (!allocate_memory(req, 1)) {
+                alloc_failures++;
+            }
+        } else if (req.process_name[0] == '@') {
+            frees++;
+            if (!release_at(atoll(req.process_name + 1))) {
+                free_failures++;
+            }
+        } else {
+            frees++;
+            if (!release_memory(req.process_name)) {
+                free_failures++;
+            }
+        }
+        elapsed += get_time_seconds() - start;
+    }
+    trace_close(&reader);
+    if (status < 0) {
+        return 1;
+    }
+    
+    collect_fragmentation(&free_total, &largest_free, &internal);
+    
+    printf("轨迹回放结果（%s，算法: %s，总内存: %lldKB）\n", path, algorithm_name(algorithm), total_memory_size);
+    printf("事件数: %lld（分配 %lld，释放 %lld），轨迹时间跨度: %.3f\n",
+           allocs + frees, allocs, frees, last_time - first_time);
+    if (reader.skipped > 0) {
+        printf("跳过页面访问记录: %lld（由请求式分页程序回放）\n", reader.skipped);
+    }
+    printf("分配失败: %lld（%.2f%%），释放未找到进程: %lld\n",
+           alloc_failures, allocs ? 100.0 * alloc_failures / allocs : 0.0, free_failures);
+    printf("分配器耗时: %.3fms，吞吐量: %.0f 操作/秒\n",
+           elapsed * 1000, elapsed > 0 ? (allocs + frees) / elapsed : 0.0);
+    printf("空闲总量: %lldKB  最大空闲块: %lldKB  外部碎片率: %.1f%%  内部碎片: %lldKB\n",
+           free_total, largest_free, external_fragmentation(free_total, largest_free) * 100, internal);
+    if (compaction_enabled) {
+        printf("紧凑次数: %d  移动数据: %lldKB  耗时: %.3fms\n",
+               compaction_count, compaction_moved, compaction_seconds * 1000);
+    }
+    if (front_cache_enabled) {
+        printf("前端缓存命中: %lld  未命中: %lld  清空次数: %d  暂存(不计入空闲): %lldKB\n",
+               front_cache_hits, front_cache_misses, front_cache_flushes, front_cache_memory);
+    }
+    if (lazy_coalesce_enabled) {
+        printf("延迟合并扫描次数: %d  结束时未合并的释放: %d\n", lazy_sweeps, lazy_dirty_frees);
+    }
+#ifdef ALLOC_PROFILE
+    profile_report();
+#endif
+    
+    // 回放结束时的状态可以保存下来，作为之后测试的初始状态
+    if (save_path) {
+        if (!save_snapshot(save_path)) {
+            clear_memory_list();
+            return 1;
+        }
+        printf("已保存快照: %s\n", save_path);
+    }
+    
+    clear_memory_list();
+    return 0;
+}
+
+/**
+ * 在按起始地址排序的快照记录中二分查找起始地址为start_addr的记录
+ * 分区记录和伙伴系统块记录都以起始地址开头且地址互不相同，由节点的地址即可得到它的下标
+ * @param records 记录数组
+ * @param record_size 每条记录的字节数
+ * @param n 记录数
+ * @param start_addr 起始地址
+ * @return 记录下标，没找到返回-1
+ */
+long long snapshot_find(const void *records, size_t record_size, long long n, long long start_addr) {
+    long long lo = 0, hi = n - 1;
+    
+    while (lo <= hi) {
+        long long mid = lo + (hi - lo) / 2;
+        long long addr = *(const long long *)((const char *)records + mid * record_size);
+        
+        if (addr == start_addr) {
+            return mid;
+        }
+        if (addr < start_addr) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return -1;
+}
+
+/**
+ * 把分配器状态保存为二进制快照：分区链表、伙伴系统块链表、位图分配和TLSF的块、各进程占用的块链表，
+ * 以及空闲分区平衡树的中序（按(大小, 起始地址)排序）、伙伴系统和TLSF空闲链表的顺序和循环首次适应游标。
+ * 进程号按1, 2, ...重新编号，恢复后的分配和释放结果与保存前的状态完全一致
+ * 注意：数组分区表是独立的测试用存储方式，不包含在快照中
+ * @param path 快照文件路径
+ * @return 保存结果：1-成功，0-失败
+ */
+int save_snapshot(const char *path) {
+    SnapshotHeader h;
+    SnapshotPartition *parts;
+    SnapshotBuddyBlock *blocks;
+    SnapshotBitmapBlock *bitmap_records;
+    SnapshotTlsfBlock *tlsf_records;
+    SnapshotProcess *procs;
+    BitmapBlock **bitmap_sorted;  // 位图分配块按起始粒度块号排序
+    unsigned int *size_order;   // 空闲分区按(大小, 起始地址)排序的下标
+    unsigned int *buddy_order;  // 伙伴系统各阶空闲链表中块的下标
+    unsigned int *tlsf_order;   // TLSF各空闲链表中块的下标
+    unsigned int *new_id;       // 原进程号到快照内进程号的映射
+    TreeNode *stack[128];       // 中序遍历平衡树用的栈，AVL树的高度远小于128
+    TreeNode *n;
+    int top = 0;
+    long long i = 0, j = 0;
+    FILE *fp;
+    int ok;
+    
+    front_cache_flush();  // 快照只记录空闲和已分配的分区，暂存的分区先合并回空闲索引
+    lazy_coalesce_sweep();  // 恢复后不知道哪些空闲分区未合并，保存前先合并
+    n = size_tree;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic));
+    h.version = SNAPSHOT_VERSION;
+    h.total_memory_size = total_memory_size;
+    h.managed_memory = managed_memory;
+    h.layout_seed = layout_seed;
+    h.free_partition_count = free_partition_count;
+    h.buddy_free_count = buddy_free_count;
+    h.next_fit_rover = -1;
+    for (Partition *p = memory_list; p; p = p->next) {
+        h.partition_count++;
+    }
+    for (BuddyBlock *b = buddy_list; b; b = b->next) {
+        h.buddy_block_count++;
+    }
+    for (int id = 1; id <= process_id_count; id++) {
+        for (BitmapBlock *b = process_by_id[id]->bitmap_blocks; b; b = b->owner_next) {
+            h.bitmap_block_count++;
+        }
+    }
+    for (TlsfBlock *b = tlsf_list; b; b = b->next) {
+        h.tlsf_block_count++;
+    }
+    h.tlsf_free_count = tlsf_free_count;
+    
+    // 记录之间用32位下标互相引用
+    if (h.partition_count >= UINT_MAX || h.buddy_block_count >= UINT_MAX ||
+        h.bitmap_block_count >= UINT_MAX || h.tlsf_block_count >= UINT_MAX) {
+        printf("分区数过多，无法保存快照\n");
+        return 0;
+    }
+    
+    // 各数组都多申请一项，避免数量为0时申请0字节
+    parts = (SnapshotPartition *)malloc(sizeof(SnapshotPartition) * (h.partition_count + 1));
+    blocks = (SnapshotBuddyBlock *)malloc(sizeof(SnapshotBuddyBlock) * (h.buddy_block_count + 1));
+    bitmap_records = (SnapshotBitmapBlock *)malloc(sizeof(SnapshotBitmapBlock) * (h.bitmap_block_count + 1));
+    tlsf_records = (SnapshotTlsfBlock *)malloc(sizeof(SnapshotTlsfBlock) * (h.tlsf_block_count + 1));
+    procs = (SnapshotProcess *)malloc(sizeof(SnapshotProcess) * (process_id_count + 1));
+    bitmap_sorted = (BitmapBlock **)malloc(sizeof(BitmapBlock *) * (h.bitmap_block_count + 1));
+    size_order = (unsigned int *)malloc(sizeof(unsigned int) * (h.free_partition_count + 1));
+    buddy_order = (unsigned int *)malloc(sizeof(unsigned int) * (h.buddy_free_count + 1));
+    tlsf_order = (unsigned int *)malloc(sizeof(unsigned int) * (h.tlsf_free_count + 1));
+    new_id = (unsigned int *)calloc(process_id_count + 1, sizeof(unsigned int));
+    if (!parts || !blocks || !bitmap_records || !tlsf_records || !procs || !bitmap_sorted ||
+        !size_order || !buddy_order || !tlsf_order || !new_id) {
+        printf("内存分配失败！\n");
+        exit(1);
+    }
+    
+    // 只保存仍占用内存的进程（回收的表项不占用内存），按原进程号顺序重新编号
+    for (int id = 1; id <= process_id_count; id++) {
+        ProcessEntry *e = process_by_id[id];
+        
+        if (e->partitions || e->buddy_blocks || e->bitmap_blocks || e->tlsf_blocks) {
+            new_id[id] = (unsigned int)++h.process_count;
+        }
+    }
+    
+    for (Partition *p = memory_list; p; p = p->next, i++) {
+        parts[i].start_addr = p->start_addr;
+        parts[i].size = p->size;
+        parts[i].process_id = p->status == FREE ? FREE_PROCESS_ID : new_id[p->process_id];
+        parts[i].owner_next = 0;
+        if (p == next_fit_rover) {
+            h.next_fit_rover = i;
+        }
+    }
+    i = 0;
+    for (BuddyBlock *b = buddy_list; b; b = b->next, i++) {
+        blocks[i].start_addr = b->start_addr;
+        blocks[i].request_size = b->request_size;
+        blocks[i].order = b->order;
+        blocks[i].process_id = b->status == FREE ? FREE_PROCESS_ID : new_id[b->process_id];
+        blocks[i].owner_next = 0;
+        blocks[i].reserved = 0;
+    }
+    
+    // 位图分配块只挂在各进程的链表上，收集后按地址排序
+    i = 0;
+    for (int id = 1; id <= process_id_count; id++) {
+        for (BitmapBlock *b = process_by_id[id]->bitmap_blocks; b; b = b->owner_next) {
+            bitmap_sorted[i++] = b;
+        }
+    }
+    qsort(bitmap_sorted, (size_t)h.bitmap_block_count, sizeof(BitmapBlock *), compare_bitmap_blocks);
+    for (i = 0; i < h.bitmap_block_count; i++) {
+        bitmap_records[i].start = bitmap_sorted[i]->start;
+        bitmap_records[i].count = bitmap_sorted[i]->count;
+        bitmap_records[i].request_size = bitmap_sorted[i]->request_size;
+        bitmap_records[i].process_id = new_id[bitmap_sorted[i]->process_id];
+        bitmap_records[i].owner_next = 0;
+    }
+    i = 0;
+    for (TlsfBlock *b = tlsf_list; b; b = b->next, i++) {
+        tlsf_records[i].start_addr = b->start_addr;
+        tlsf_records[i].size = b->size;
+        tlsf_records[i].process_id = b->status == FREE ? FREE_PROCESS_ID : new_id[b->process_id];
+        tlsf_records[i].owner_next = 0;
+    }
+    
+    // 各进程的分区链表和块链表：记录链表头和每个节点的后继
+    for (int id = 1; id <= process_id_count; id++) {
+        ProcessEntry *e = process_by_id[id];
+        SnapshotProcess *r;
+        
+        if (!new_id[id]) {
+            continue;
+        }
+        r = &procs[new_id[id] - 1];
+        memset(r->process_name, 0, sizeof(r->process_name));
+        strcpy(r->process_name, e->process_name);
+        r->partitions = 0;
+        r->buddy_blocks = 0;
+        r->bitmap_blocks = 0;
+        r->tlsf_blocks = 0;
+        for (Partition *p = e->partitions; p; p = p->owner_next) {
+            unsigned int k = (unsigned int)snapshot_find(parts, sizeof(SnapshotPartition), h.partition_count, p->start_addr);
+            
+            if (p == e->partitions) {
+                r->partitions = k + 1;
+            }
+            if (p->owner_next) {
+                parts[k].owner_next = (unsigned int)snapshot_find(parts, sizeof(SnapshotPartition),
+                                                                  h.partition_count, p->owner_next->start_addr) + 1;
+            }
+        }
+        for (BuddyBlock *b = e->buddy_blocks; b; b = b->owner_next) {
+            unsigned int k = (unsigned int)snapshot_find(blocks, sizeof(SnapshotBuddyBlock), h.buddy_block_count, b->start_addr);
+            
+            if (b == e->buddy_blocks) {
+                r->buddy_blocks = k + 1;
+            }
+            if (b->owner_next) {
+                blocks[k].owner_next = (unsigned int)snapshot_find(blocks, sizeof(SnapshotBuddyBlock),
+                                                                   h.buddy_block_count, b->owner_next->start_addr) + 1;
+            }
+        }
+        for (BitmapBlock *b = e->bitmap_blocks; b; b = b->owner_next) {
+            unsigned int k = (unsigned int)snapshot_find(bitmap_records, sizeof(SnapshotBitmapBlock), h.bitmap_block_count, b->start);
+            
+            if (b == e->bitmap_blocks) {
+                r->bitmap_blocks = k + 1;
+            }
+            if (b->owner_next) {
+                bitmap_records[k].owner_next = (unsigned int)snapshot_find(bitmap_records, sizeof(SnapshotBitmapBlock),
+                                                                           h.bitmap_block_count, b->owner_next->start) + 1;
+            }
+        }
+        for (TlsfBlock *b = e->tlsf_blocks; b; b = b->owner_next) {
+            unsigned int k = (unsigned int)snapshot_find(tlsf_records, sizeof(SnapshotTlsfBlock), h.tlsf_block_count, b->start_addr);
+            
+            if (b == e->tlsf_blocks) {
+                r->tlsf_blocks = k + 1;
+            }
+            if (b->owner_next) {
+                tlsf_records[k].owner_next = (unsigned int)snapshot_find(tlsf_records, sizeof(SnapshotTlsfBlock),
+                                                                         h.tlsf_block_count, b->owner_next->start_addr) + 1;
+            }
+        }
+    }
+    
+    // 中序遍历平衡树，得到空闲分区按(大小, 起始地址)排序的下标
+    while (n || top > 0) {
+        while (n) {
+            stack[top++] = n;
+            n = n->left;
+        }
+        n = stack[--top];
+        size_order[j++] = (unsigned int)snapshot_find(parts, sizeof(SnapshotPartition), h.partition_count,
+                                                      PARTITION_OF(n, size_node)->start_addr);
+        n = n->right;
+    }
+    
+    // 伙伴系统按阶从低到高、每阶从链表头开始记录空闲块
+    j = 0;
+    for (int k = 0; k < BUDDY_ORDER_COUNT; k++) {
+        for (BuddyBlock *b = buddy_free_lists[k]; b; b = b->free_next) {
+            buddy_order[j++] = (unsigned int)snapshot_find(blocks, sizeof(SnapshotBuddyBlock), h.buddy_block_count, b->start_addr);
+        }
+    }
+    
+    // TLSF按(一级, 二级)从低到高、每条链表从链表头开始记录空闲块
+    j = 0;
+    for (int fl = 0; fl < TLSF_FL_COUNT; fl++) {
+        for (int sl = 0; sl < TLSF_SL_COUNT; sl++) {
+            for (TlsfBlock *b = tlsf_free_lists[fl][sl]; b; b = b->free_next) {
+                tlsf_order[j++] = (unsigned int)snapshot_find(tlsf_records, sizeof(SnapshotTlsfBlock), h.tlsf_block_count, b->start_addr);
+            }
+        }
+    }
+    
+    fp = fopen(path, "wb");
+    ok = fp != NULL;
+    if (ok) {
+        ok = fwrite(&h, sizeof(h), 1, fp) == 1 &&
+             fwrite(parts, sizeof(SnapshotPartition), (size_t)h.partition_count, fp) == (size_t)h.partition_count &&
+             fwrite(blocks, sizeof(SnapshotBuddyBlock), (size_t)h.buddy_block_count, fp) == (size_t)h.buddy_block_count &&
+             fwrite(bitmap_records, sizeof(SnapshotBitmapBlock), (size_t)h.bitmap_block_count, fp) == (size_t)h.bitmap_block_count &&
+             fwrite(tlsf_records, sizeof(SnapshotTlsfBlock), (size_t)h.tlsf_block_count, fp) == (size_t)h.tlsf_block_count &&
+             fwrite(procs, sizeof(SnapshotProcess), (size_t)h.process_count, fp) == (size_t)h.process_count &&
+             fwrite(size_order, sizeof(unsigned int), (size_t)h.free_partition_count, fp) == (size_t)h.free_partition_count &&
+             fwrite(buddy_order, sizeof(unsigned int), (size_t)h.buddy_free_count, fp) == (size_t)h.buddy_free_count &&
+             fwrite(tlsf_order, sizeof(unsigned int), (size_t)h.tlsf_free_count, fp) == (size_t)h.tlsf_free_count;
+        ok = fclose(fp) == 0 && ok;
+    }
+    if (!ok) {
+        printf("无法写入快照文件: %s\n", path);
+    }
+    
+    free(parts);
+    free(blocks);
+    free(bitmap_records);
+    free(tlsf_records);
+    free(procs);
+    free(bitmap_sorted);
+    free(size_order);
+    free(buddy_order);
+    free(tlsf_order);
+    free(new_id);
+    return ok;
+}
+
+/**
+ * 检查快照内容是否完整一致：长度与文件头相符，所有下标都在范围内，
+ * 空闲分区的排序下标严格递增，伙伴系统和TLSF空闲块不重复，位图分配块都在内存段之内，
+ * 进程链表只连接该进程的已分配节点
+ * @return 1-有效，0-无效
+ */
+int snapshot_valid(const char *data, long long length) {
+    const SnapshotHeader *h = (const SnapshotHeader *)data;
+    const SnapshotPartition *parts = (const SnapshotPartition *)(h + 1);
+    const SnapshotBuddyBlock *blocks;
+    const SnapshotBitmapBlock *bitmap_records;
+    const SnapshotTlsfBlock *tlsf_records;
+    const SnapshotProcess *procs;
+    const unsigned int *size_order, *buddy_order, *tlsf_order;
+    long long free_count = 0, buddy_free = 0, tlsf_free = 0;
+    long long granule;      // 位图的粒度大小
+    long long segment = 0, segment_next = 0, end = 0;  // 当前和下一个内存段开头的分区下标，当前内存段的结束地址
+    unsigned char *listed;  // 伙伴系统或TLSF空闲块是否已出现在空闲链表顺序中
+    int ok = 1;
+    
+    if (length < (long long)sizeof(SnapshotHeader) ||
+        memcmp(h->magic, SNAPSHOT_MAGIC, sizeof(h->magic)) != 0 || h->version != SNAPSHOT_VERSION) {
+        return 0;
+    }
+    if (h->total_memory_size <= 0 || h->managed_memory < 0 || h->partition_count < 0 || h->partition_count >= UINT_MAX ||
+        h->buddy_block_count < 0 || h->buddy_block_count >= UINT_MAX ||
+        h->process_count < 0 || h->process_count >= UINT_MAX ||
+        h->free_partition_count < 0 || h->free_partition_count > h->partition_count ||
+        h->buddy_free_count < 0 || h->buddy_free_count > h->buddy_block_count ||
+        h->next_fit_rover < -1 || h->next_fit_rover >= h->partition_count ||
+        h->bitmap_block_count < 0 || h->bitmap_block_count >= UINT_MAX ||
+        h->tlsf_block_count < 0 || h->tlsf_block_count >= UINT_MAX ||
+        h->tlsf_free_count < 0 || h->tlsf_free_count > h->tlsf_block_count ||
+        length != (long long)sizeof(SnapshotHeader) +
+                  h->partition_count * (long long)sizeof(SnapshotPartition) +
+                  h->buddy_block_count * (long long)sizeof(SnapshotBuddyBlock) +
+                  h->bitmap_block_count * (long long)sizeof(SnapshotBitmapBlock) +
+                  h->tlsf_block_count * (long long)sizeof(SnapshotTlsfBlock) +
+                  h->process_count * (long long)sizeof(SnapshotProcess) +
+                  (h->free_partition_count + h->buddy_free_count + h->tlsf_free_count) * (long long)sizeof(unsigned int)) {
+        return 0;
+    }
+    blocks = (const SnapshotBuddyBlock *)(parts + h->partition_count);
+    bitmap_records = (const SnapshotBitmapBlock *)(blocks + h->buddy_block_count);
+    tlsf_records = (const SnapshotTlsfBlock *)(bitmap_records + h->bitmap_block_count);
+    procs = (const SnapshotProcess *)(tlsf_records + h->tlsf_block_count);
+    size_order = (const unsigned int *)(procs + h->process_count);
+    buddy_order = size_order + h->free_partition_count;
+    tlsf_order = buddy_order + h->buddy_free_count;
+    
+    // 分区按地址递增且互不重叠；同一进程链表中的后继必须属于同一进程
+    for (long long i = 0; i < h->partition_count; i++) {
+        const SnapshotPartition *r = &parts[i];
+        
+        if (r->start_addr < 0 || r->size <= 0 || r->size > LLONG_MAX - r->start_addr ||
+            r->process_id > h->process_count ||
+            (i > 0 && r->start_addr < parts[i - 1].start_addr + parts[i - 1].size) ||
+            r->owner_next > h->partition_count ||
+            (r->owner_next && (r->process_id == FREE_PROCESS_ID || parts[r->owner_next - 1].process_id != r->process_id))) {
+            return 0;
+        }
+        if (r->process_id == FREE_PROCESS_ID) {
+            free_count++;
+        }
+    }
+    if (free_count != h->free_partition_count) {
+        return 0;
+    }
+    for (long long j = 0; j < h->free_partition_count; j++) {
+        const SnapshotPartition *r, *q;
+        
+        if (size_order[j] >= h->partition_count || parts[size_order[j]].process_id != FREE_PROCESS_ID) {
+            return 0;
+        }
+        r = &parts[size_order[j]];
+        q = j > 0 ? &parts[size_order[j - 1]] : NULL;
+        if (q && (q->size > r->size || (q->size == r->size && q->start_addr >= r->start_addr))) {
+            return 0;  // 必须按(大小, 起始地址)严格递增
+        }
+    }
+    
+    for (long long i = 0; i < h->buddy_block_count; i++) {
+        const SnapshotBuddyBlock *r = &blocks[i];
+        
+        // 块按自身大小对齐，已分配块的请求大小不超过块大小
+        if (r->order < 0 || r->order >= BUDDY_ORDER_COUNT || r->start_addr < 0 ||
+            r->start_addr % (1LL << r->order) != 0 || r->start_addr > LLONG_MAX - (1LL << r->order) ||
+            (r->process_id != FREE_PROCESS_ID && (r->request_size <= 0 || r->request_size > 1LL << r->order)) ||
+            r->process_id > h->process_count ||
+            (i > 0 && r->start_addr < blocks[i - 1].start_addr + (1LL << blocks[i - 1].order)) ||
+            r->owner_next > h->buddy_block_count ||
+            (r->owner_next && (r->process_id == FREE_PROCESS_ID || blocks[r->owner_next - 1].process_id != r->process_id))) {
+            return 0;
+        }
+        if (r->process_id == FREE_PROCESS_ID) {
+            buddy_free++;
+        }
+    }
+    if (buddy_free != h->buddy_free_count) {
+        return 0;
+    }
+    listed = (unsigned char *)calloc(h->buddy_block_count + 1, 1);
+    if (!listed) {
+        printf("内存分配失败！\n");
+        exit(1);
+    }
+    for (long long j = 0; j < h->buddy_free_count && ok; j++) {
+        unsigned int k = buddy_order[j];
+        
+        ok = k < h->buddy_block_count && blocks[k].process_id == FREE_PROCESS_ID && !listed[k] &&
+             (j == 0 || blocks[buddy_order[j - 1]].order <= blocks[k].order);
+        if (ok) {
+            listed[k] = 1;
+        }
+    }
+    free(listed);
+    if (!ok) {
+        return 0;
+    }
+    
+    // 位图分配块按地址递增且互不重叠，每块都在一个内存段（地址相连的分区）覆盖的完整粒度块之内，
+    // 这样恢复时标记为已占用的粒度块原来一定是空闲的
+    granule = bitmap_granule_for(h->partition_count > 0 ?
+                                 parts[h->partition_count - 1].start_addr + parts[h->partition_count - 1].size : 0);
+    for (long long i = 0; i < h->bitmap_block_count; i++) {
+        const SnapshotBitmapBlock *r = &bitmap_records[i];
+        
+        if (r->start < 0 || r->count <= 0 || r->count > LLONG_MAX / granule - r->start ||
+            r->process_id == FREE_PROCESS_ID || r->process_id > h->process_count ||
+            r->request_size <= 0 || r->request_size > r->count * granule ||
+            (i > 0 && r->start < bitmap_records[i - 1].start + bitmap_records[i - 1].count) ||
+            r->owner_next > h->bitmap_block_count ||
+            (r->owner_next && bitmap_records[r->owner_next - 1].process_id != r->process_id)) {
+            return 0;
+        }
+        while (end / granule < r->start + r->count) {
+            if (segment_next >= h->partition_count) {
+                return 0;  // 块在最后一个内存段之后
+            }
+            segment = segment_next;
+            end = parts[segment].start_addr + parts[segment].size;
+            for (segment_next = segment + 1; segment_next < h->partition_count && parts[segment_next].start_addr == end; segment_next++) {
+                end += parts[segment_next].size;
+            }
+        }
+        if ((parts[segment].start_addr + granule - 1) / granule > r->start) {
+            return 0;  // 块在内存段之间的间隙中
+        }
+    }
+    
+    // TLSF块按地址递增且互不重叠
+    for (long long i = 0; i < h->tlsf_block_count; i++) {
+        const SnapshotTlsfBlock *r = &tlsf_records[i];
+        
+        if (r->start_addr < 0 || r->size <= 0 || r->size > LLONG_MAX - r->start_addr ||
+            r->process_id > h->process_count ||
+            (i > 0 && r->start_addr < tlsf_records[i - 1].start_addr + tlsf_records[i - 1].size) ||
+            r->owner_next > h->tlsf_block_count ||
+            (r->owner_next && (r->process_id == FREE_PROCESS_ID || tlsf_records[r->owner_next - 1].process_id != r->process_id))) {
+            return 0;
+        }
+        if (r->process_id == FREE_PROCESS_ID) {
+            tlsf_free++;
+        }
+    }
+    if (tlsf_free != h->tlsf_free_count) {
+        return 0;
+    }
+    listed = (unsigned char *)calloc(h->tlsf_block_count + 1, 1);
+    if (!listed) {
+        printf("内存分配失败！\n");
+        exit(1);
+    }
+    for (long long j = 0; j < h->tlsf_free_count && ok; j++) {
+        unsigned int k = tlsf_order[j];
+        
+        ok = k < h->tlsf_block_count && tlsf_records[k].process_id == FREE_PROCESS_ID && !listed[k];
+        if (ok) {
+            listed[k] = 1;
+        }
+    }
+    free(listed);
+    
+    // 进程名以'\0'结尾，链表头属于该进程
+    for (long long i = 0; i < h->process_count && ok; i++) {
+        const SnapshotProcess *r = &procs[i];
+        
+        ok = memchr(r->process_name, '\0', sizeof(r->process_name)) != NULL &&
+             r->partitions <= h->partition_count && r->buddy_blocks <= h->buddy_block_count &&
+             r->bitmap_blocks <= h->bitmap_block_count && r->tlsf_blocks <= h->tlsf_block_count &&
+             (!r->partitions || parts[r->partitions - 1].process_id == i + 1) &&
+             (!r->buddy_blocks || blocks[r->buddy_blocks - 1].process_id == i + 1) &&
+             (!r->bitmap_blocks || bitmap_records[r->bitmap_blocks - 1].process_id == i + 1) &&
+             (!r->tlsf_blocks || tlsf_records[r->tlsf_blocks - 1].process_id == i + 1);
+    }
+    return ok;
+}
+
+/**
+ * 由内存中的快照内容恢复分配器状态，原有的分区、伙伴系统块和进程索引全部丢弃
+ * 节点按地址顺序从节点池中依次取出；平衡树直接由保存的有序下标在O(n)时间内建立，
+ * 不做逐个插入和旋转；各项占用和碎片统计随节点一并恢复
+ * @param data 快照内容
+ * @param length 快照长度（字节）
+ * @return 恢复结果：1-成功，0-失败（内容无效，原状态不变）
+ */
+int restore_snapshot(const char *data, long long length) {
+    const SnapshotHeader *h = (const SnapshotHeader *)data;
+    const SnapshotPartition *parts = (const SnapshotPartition *)(h + 1);
+    const SnapshotBuddyBlock *blocks;
+    const SnapshotBitmapBlock *bitmap_records;
+    const SnapshotTlsfBlock *tlsf_records;
+    const SnapshotProcess *procs;
+    const unsigned int *size_order, *buddy_order, *tlsf_order;
+    Partition **nodes;     // 下标对应的分区节点
+    BuddyBlock **bnodes;   // 下标对应的伙伴系统块节点
+    BitmapBlock **mnodes;  // 下标对应的位图分配块节点
+    TlsfBlock **tnodes;    // 下标对应的TLSF块节点
+    TreeNode **sorted;     // 按(大小, 起始地址)排序的空闲分区树节点
+    BuddyBlock *tail = NULL;
+    TlsfBlock *tlsf_tail = NULL;
+    
+    if (!snapshot_valid(data, length)) {
+        printf("快照文件已损坏或格式不符\n");
+        return 0;
+    }
+    blocks = (const SnapshotBuddyBlock *)(parts + h->partition_count);
+    bitmap_records = (const SnapshotBitmapBlock *)(blocks + h->buddy_block_count);
+    tlsf_records = (const SnapshotTlsfBlock *)(bitmap_records + h->bitmap_block_count);
+    procs = (const SnapshotProcess *)(tlsf_records + h->tlsf_block_count);
+    size_order = (const unsigned int *)(procs + h->process_count);
+    buddy_order = size_order + h->free_partition_count;
+    tlsf_order = buddy_order + h->buddy_free_count;
+    
+    clear_memory_list();
+    total_memory_size = h->total_memory_size;
+    managed_memory = h->managed_memory;
+    layout_seed = (unsigned int)h->layout_seed;
+    
+    // 进程索引已清空，按记录顺序驻留进程名，得到的进程号正好是1, 2, ...
+    // 哈希表预先扩到足够大，避免驻留过程中反复扩容
+    while (process_table_size < h->process_count) {
+        process_table_grow();
+    }
+    for (long long i = 0; i < h->process_count; i++) {
+        if (intern_process(procs[i].process_name) != (unsigned int)(i + 1)) {
+            printf("快照文件中有重复的进程名: %s\n", procs[i].process_name);
+            clear_memory_list();
+            return 0;
+        }
+    }
+    
+    nodes = (Partition **)malloc(sizeof(Partition *) * (h->partition_count + 1));
+    bnodes = (BuddyBlock **)malloc(sizeof(BuddyBlock *) * (h->buddy_block_count + 1));
+    mnodes = (BitmapBlock **)malloc(sizeof(BitmapBlock *) * (h->bitmap_block_count + 1));
+    tnodes = (TlsfBlock **)malloc(sizeof(TlsfBlock *) * (h->tlsf_block_count + 1));
+    sorted = (TreeNode **)malloc(sizeof(TreeNode *) * (h->free_partition_count + 1));
+    if (!nodes || !bnodes || !mnodes || !tnodes || !sorted) {
+        printf("内存分配失败！\n");
+        exit(1);
+    }
+    
+    for (long long i = 0; i < h->partition_count; i++) {
+        Partition *p = (Partition *)pool_alloc(&partition_pool);
+        if (!p) {
+            printf("内存分配失败！\n");
+            exit(1);
+        }
+        
+        p->start_addr = parts[i].start_addr;
+        p->size = parts[i].size;
+        p->process_id = parts[i].process_id;
+        p->status = p->process_id == FREE_PROCESS_ID ? FREE : BUSY;
+        p->next = NULL;
+        p->prev = i > 0 ? nodes[i - 1] : NULL;
+        p->owner_prev = NULL;
+        p->owner_next = NULL;
+        if (p->prev) {
+            p->prev->next = p;
+        } else {
+            memory_list = p;
+        }
+        if (p->status == FREE) {
+            free_list_insert(p);  // 分级空闲链表中的顺序不影响查找结果
+            free_memory += p->size;
+            free_partition_count++;
+        }
+        nodes[i] = p;
+    }
+    for (long long i = 0; i < h->partition_count; i++) {
+        if (parts[i].owner_next) {
+            nodes[i]->owner_next = nodes[parts[i].owner_next - 1];
+            nodes[i]->owner_next->owner_prev = nodes[i];
+        }
+    }
+    for (long long j = 0; j < h->free_partition_count; j++) {
+        sorted[j] = &nodes[size_order[j]]->size_node;
+    }
+    size_tree = tree_build_sorted(sorted, h->free_partition_count, size_tree_update);
+    addr_index_rebuild();
+    if (h->free_partition_count > 0) {
+        largest_free_partition = nodes[size_order[h->free_partition_count - 1]];
+    }
+    if (h->next_fit_rover >= 0) {
+        next_fit_rover = nodes[h->next_fit_rover];
+    }
+    
+    for (long long i = 0; i < h->buddy_block_count; i++) {
+        BuddyBlock *b = buddy_new_block(blocks[i].start_addr, blocks[i].order, tail);
+        
+        if (blocks[i].process_id != FREE_PROCESS_ID) {
+            b->status = BUSY;
+            b->process_id = blocks[i].process_id;
+            b->request_size = blocks[i].request_size;
+            buddy_internal += (1LL << b->order) - b->request_size;
+        }
+        bnodes[i] = tail = b;
+    }
+    for (long long i = 0; i < h->buddy_block_count; i++) {
+        if (blocks[i].owner_next) {
+            bnodes[i]->owner_next = bnodes[blocks[i].owner_next - 1];
+        }
+    }
+    // 逆序插入到链表头部，各阶空闲链表恢复为保存时的顺序
+    for (long long j = h->buddy_free_count - 1; j >= 0; j--) {
+        buddy_free_list_insert(bnodes[buddy_order[j]]);
+    }
+    
+    // 位图按恢复的内存段建立后，再把各已分配块覆盖的粒度块标记为已占用
+    bitmap_initialize();
+    for (long long i = 0; i < h->bitmap_block_count; i++) {
+        BitmapBlock *b = (BitmapBlock *)pool_alloc(&bitmap_pool);
+        if (!b) {
+            printf("内存分配失败！\n");
+            exit(1);
+        }
+        
+        b->start = bitmap_records[i].start;
+        b->count = bitmap_records[i].count;
+        b->request_size = bitmap_records[i].request_size;
+        b->process_id = bitmap_records[i].process_id;
+        b->owner_next = NULL;
+        bitmap_take(b->start, b->count);
+        bitmap_internal += b->count * bitmap_granule - b->request_size;
+        mnodes[i] = b;
+    }
+    for (long long i = 0; i < h->bitmap_block_count; i++) {
+        if (bitmap_records[i].owner_next) {
+            mnodes[i]->owner_next = mnodes[bitmap_records[i].owner_next - 1];
+        }
+    }
+    
+    for (long long i = 0; i < h->tlsf_block_count; i++) {
+        TlsfBlock *b = tlsf_new_block(tlsf_records[i].start_addr, tlsf_records[i].size, tlsf_tail);
+        
+        if (tlsf_records[i].process_id != FREE_PROCESS_ID) {
+            b->status = BUSY;
+            b->process_id = tlsf_records[i].process_id;
+        }
+        tnodes[i] = tlsf_tail = b;
+    }
+    for (long long i = 0; i < h->tlsf_block_count; i++) {
+        if (tlsf_records[i].owner_next) {
+            tnodes[i]->owner_next = tnodes[tlsf_records[i].owner_next - 1];
+        }
+    }
+    // 与伙伴系统相同，逆序插入到链表头部，各空闲链表恢复为保存时的顺序
+    for (long long j = h->tlsf_free_count - 1; j >= 0; j--) {
+        tlsf_free_list_insert(tnodes[tlsf_order[j]]);
+    }
+    
+    for (long long i = 0; i < h->process_count; i++) {
+        ProcessEntry *e = process_by_id[i + 1];
+        e->partitions = procs[i].partitions ? nodes[procs[i].partitions - 1] : NULL;
+        e->buddy_blocks = procs[i].buddy_blocks ? bnodes[procs[i].buddy_blocks - 1] : NULL;
+        e->bitmap_blocks = procs[i].bitmap_blocks ? mnodes[procs[i].bitmap_blocks - 1] : NULL;
+        e->tlsf_blocks = procs[i].tlsf_blocks ? tnodes[procs[i].tlsf_blocks - 1] : NULL;
+    }
+    
+    free(nodes);
+    free(bnodes);
+    free(mnodes);
+    free(tnodes);
+    free(sorted);
+    return 1;
+}
+
+/**
+ * 映射快照文件并一次恢复全部分配器状态：文件不经过读缓冲复制，
+ * 恢复时直接在映射的内存上按下标访问各条记录
+ * @param path 快照文件路径
+ * @return 恢复结果：1-成功，0-失败
+ */
+int load_snapshot(const char *path) {
+    HANDLE file, mapping;
+    LARGE_INTEGER file_size;
+    const char *view;
+    int ok;
+    
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        printf("无法打开快照文件: %s\n", path);
+        return 0;
+    }
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart < (long long)sizeof(SnapshotHeader)) {
+        printf("不是有效的快照文件: %s\n", path);
+        CloseHandle(file);
+        return 0;
+    }
+    
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    view = mapping ? (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!view) {
+        printf("无法映射快照文件: %s\n", path);
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        return 0;
+    }
+    
+    ok = restore_snapshot(view, file_size.QuadPart);
+    
+    UnmapViewOfFile(view);
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return ok;
+}
+
+/**
+ * 构造一个碎片化的内存：已分配分区与随机大小的空闲分区交替排列
+ * @param holes 空闲分区数量
+ * @param fit_last 非0时前面的空闲分区都小于1000KB，只有地址最高的一个为1024KB，
+ *                 大小为1000~1024KB的请求只有这一个分区放得下
+ */
+void build_fragmented_memory(int holes, int fit_last) {
+    Partition *last = NULL;
+    long long current_addr = 0;
+    
+    clear_memory_list();
+    
+    for (int i = 0; i < holes * 2; i++) {
+        Partition *p = (Partition *)pool_alloc(&partition_pool);
+        if (!p) {
+            printf("内存分配失败！\n");
+            exit(1);
+        }
+        
+        p->start_addr = current_addr;
+        p->next = NULL;
+        p->prev = last;
+        if (i % 2 == 0) {
+            p->size = 1;                      // 1KB的已分配分区把空闲分区隔开
+            p->status = BUSY;
+            p->process_id = intern_process("bench");
+            process_attach(p);
+        } else {
+            if (!fit_last) {
+                p->size = 1 + rand() % 1024;  // 空闲分区大小在1~1024KB之间
+            } else if (i < holes * 2 - 1) {
+                p->size = 1 + rand() % 999;   // 1~999KB，放不下查找用的请求
+            } else {
+                p->size = 1024;               // 唯一放得下的分区在最后
+            }
+            p->status = FREE;
+            p->process_id = FREE_PROCESS_ID;
+            free_index_insert(p);
+        }
+        current_addr += p->size;
+        
+        if (last) {
+            last->next = p;
+        } else {
+            memory_list = p;
+        }
+        last = p;
+    }
+    total_memory_size = current_addr;
+    addr_index_rebuild();
+}
+
+/**
+ * 测试最佳/最坏适应查找延迟随空闲分区数的变化
+ * 每个规模下对随机请求大小各查找若干次，输出平均每次查找耗时；
+ * 另测最佳适应下一次分配加释放（含分割、合并和指标更新）以及一次指标查询的耗时
+ */
+void benchmark_fit_lookup() {
+    int sizes[] = {1000, 10000, 100000, 1000000, 10000000};  // 空闲分区数量
+    int lookups = 1000000;                         // 每种算法的查找次数
+    volatile Partition *sink = NULL;               // 防止查找结果被编译器优化掉
+    volatile long long metrics_sink = 0;
+    long long *requests = (long long *)malloc(sizeof(long long) * lookups);  // 预先生成的请求大小，避免计时包含rand()
+    int saved_algorithm = algorithm;
+    
+    if (!requests) {
+        printf("内存分配失败！\n");
+        return;
+    }
+    srand(1);
+    for (int j = 0; j < lookups; j++) {
+        requests[j] = 1 + rand() % 1024;
+    }
+    
+    printf("\n最佳/最坏适应查找延迟测试（每种算法查找%d次）\n", lookups);
+    printf("---------------------------------------------------------------------------------------\n");
+    printf("| 空闲分区数 | 树高 | 最佳适应(ns/次) | 最坏适应(ns/次) | 分配+释放(ns/次) | 指标查询(ns/次) |\n");
+    printf("---------------------------------------------------------------------------------------\n");
+    
+    for (int i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++) {
+        double start, best_ns, worst_ns, churn_ns, metrics_ns;
+        Request req;
+        MemoryMetrics m;
+        
+        build_fragmented_memory(sizes[i], 0);
+        
+        start = get_time_seconds();
+        for (int j = 0; j < lookups; j++) {
+            sink = best_fit(requests[j]);
+        }
+        best_ns = (get_time_seconds() - start) * 1e9 / lookups;
+        
+        start = get_time_seconds();
+        for (int j = 0; j < lookups; j++) {
+            sink = worst_fit(requests[j]);
+        }
+        worst_ns = (get_time_seconds() - start) * 1e9 / lookups;
+        
+        // 分配后立即释放，布局复原，每次都经过分割、合并和空闲索引的增量维护
+        algorithm = BEST_FIT;
+        strcpy(req.process_name, "probe");
+        start = get_time_seconds();
+        for (int j = 0; j < lookups; j++) {
+            req.size = requests[j];
+            allocate_memory(req, 1);
+            release_memory(req.process_name);
+        }
+        churn_ns = (get_time_seconds() - start) * 1e9 / lookups;
+        
+        start = get_time_seconds();
+        for (int j = 0; j < lookups; j++) {
+            query_metrics(&m);
+            metrics_sink += m.hole_count;
+        }
+        metrics_ns = (get_time_seconds() - start) * 1e9 / lookups;
+        
+        printf("| %-10d | %-4d | %-15.1f | %-15.1f | %-16.1f | %-15.1f |\n",
+               sizes[i], tree_height(size_tree), best_ns, worst_ns, churn_ns, metrics_ns);
+    }
+    printf("---------------------------------------------------------------------------------------\n");
+    (void)sink;
+    (void)metrics_sink;
+    
+    algorithm = saved_algorithm;
+    free(requests);
+    clear_memory_list();
+}
+
+/**
+ * 在同一负载下比较各分配算法（含伙伴系统和位图分配）的吞吐量、失败次数和碎片
+ * 负载预先生成：每个进程申请随机大小的内存，若干次操作后释放，
+ * 因此每种算法执行完全相同的操作序列
+ */
+void benchmark_policies() {
+    int ops = 200000;          // 分配操作次数
+    int max_lifetime = 64;     // 进程存活的最大操作数
+    int policies[] = {FIRST_FIT, BEST_FIT, WORST_FIT, NEXT_FIT, BUDDY_SYSTEM, BITMAP_SYSTEM, TLSF_SYSTEM};
+    Request *allocs = (Request *)malloc(sizeof(Request) * ops);   // 第i次操作分配的请求
+    int *release_at = (int *)malloc(sizeof(int) * ops);           // 第i次操作申请的内存在哪次操作后释放
+    int *release_head = (int *)malloc(sizeof(int) * (ops + max_lifetime + 1)); // 每次操作后要释放的进程链表头
+    int *release_next = (int *)malloc(sizeof(int) * ops);
+    
+    if (!allocs || !release_at || !release_head || !release_next) {
+        printf("内存分配失败！\n");
+        exit(1);
+    }
+    
+    // 生成负载：大小1~256KB均匀分布，存活1~max_lifetime次操作
+    srand(1);
+    for (int i = 0; i < ops + max_lifetime + 1; i++) {
+        release_head[i] = -1;
+    }
+    for (int i = 0; i < ops; i++) {
+        sprintf(allocs[i].process_name, "P%d", i);
+        allocs[i].size = 1 + rand() % 256;
+        release_at[i] = i + 1 + rand() % max_lifetime;
+        release_next[i] = release_head[release_at[i]];
+        release_head[release_at[i]] = i;
+    }
+    
+    total_memory_size = 8 * 1024;   // 8MB内存，平均约占用一半，足以产生分配失败
+    
+    printf("\n分配算法对比测试（%d次分配，总内存%lldKB）\n", ops, total_memory_size);
+    printf("-------------------------------------------------------------------------------------------------------------\n");
+    printf("| 算法         | 紧凑 | 吞吐量(操作/秒) | 分配失败 | 外部碎片率 | 内部碎片(KB) | 紧凑移动(KB) | 紧凑耗时(ms) |\n");
+    printf("-------------------------------------------------------------------------------------------------------------\n");
+    
+    for (int run = 0; run < (int)(sizeof(policies) / sizeof(policies[0])) * 2; run++) {
+        int failures = 0;
+        long long free_total, largest_free, internal;
+        double start, elapsed;
+        int i = run / 2;
+        
+        // 每种可变分区算法分别在关闭和开启紧凑时各运行一次，伙伴系统、位图分配和TLSF不支持紧凑
+        compaction_enabled = run % 2;
+        if (policies[i] >= BUDDY_SYSTEM && compaction_enabled) {
+            continue;
+        }
+        compaction_count = 0;
+        compaction_moved = 0;
+        compaction_seconds = 0;
+        
+        // 每种算法从相同的初始布局开始
+        build_memory_segments(2);
+        algorithm = policies[i];
+        
+        start = get_time_seconds();
+        for (int t = 0; t < ops; t++) {
+            if (!allocate_memory(allocs[t], 1)) {
+                failures++;
+            }
+            for (int r = release_head[t]; r != -1; r = release_next[r]) {
+                release_memory(allocs[r].process_name);
+            }
+        }
+        elapsed = get_time_seconds() - start;
+        
+        // 碎片在负载进行中统计（尚未释放的进程仍占用内存）
+        collect_fragmentation(&free_total, &largest_free, &internal);
+        printf("| %-12s | %-4s | %-15.0f | %-8d | %9.1f%% | %-12lld | %-12lld | %-12.2f |\n",
+               algorithm_name(policies[i]), compaction_enabled ? "开启" : "关闭",
+               ops / elapsed, failures,
+               external_fragmentation(free_total, largest_free) * 100, internal,
+               compaction_moved, compaction_seconds * 1000);
+    }
+    printf("-------------------------------------------------------------------------------------------------------------\n");
+    compaction_enabled = 0;
+    
+    free(allocs);
+    free(release_at);
+    free(release_head);
+    free(release_next);
+    clear_memory_list();
+}
+
+/**
+ * 比较批量分配与逐个分配：每轮在相同的初始内存上接纳一组作业，
+ * 统计每种算法两种方式的接纳率、每秒接纳数和接纳后的外部碎片率
+ */
+void benchmark_batch() {
+    int rounds = 2000;         // 作业组数
+    int jobs = 64;             // 每组作业数
+    int policies[] = {FIRST_FIT, BEST_FIT, WORST_FIT, NEXT_FIT, BUDDY_SYSTEM, BITMAP_SYSTEM, TLSF_SYSTEM};
+    Request *mix = (Request *)malloc(sizeof(Request) * rounds * jobs);
+    int *results = (int *)malloc(sizeof(int) * jobs);  // 每组作业的分配结果
+    
+    if (!mix || !results) {
+        printf("内存分配失败！\n");
+        exit(1);
+    }
+    
+    // 作业大小在1~224KB之间，每组总需求平均约为总内存的88%，
+    // 内存布局本身是碎片化的，所以放置顺序决定了能接纳多少
+    srand(1);
+    for (int i = 0; i < rounds * jobs; i++) {
+        sprintf(mix[i].process_name, "J%d", i % jobs);
+        mix[i].size = 1 + rand() % 224;
+    }
+    total_memory_size = 8 * 1024;
+    
+    printf("\n批量分配对比测试（%d组作业，每组%d个，总内存%lldKB）\n", rounds, jobs, total_memory_size);
+    printf("------------------------------------------------------------------------------------\n");
+    printf("| 算法         | 方式 | 接纳率  | 接纳内存占比 | 接纳数/秒     | 平均外部碎片率 |\n");
+    printf("------------------------------------------------------------------------------------\n");
+    
+    for (int i = 0; i < (int)(sizeof(policies) / sizeof(policies[0])); i++) {
+        for (int batch = 0; batch <= 1; batch++) {
+            int admitted = 0;
+            long long free_total, largest_free, internal;
+            double elapsed = 0, fragmentation = 0;
+            long long demanded_kb = 0, admitted_kb = 0;  // 请求总量与接纳总量(KB)
+            
+            algorithm = policies[i];
+            for (int r = 0; r < rounds; r++) {
+                double start;
+                
+                build_memory_segments(2);  // 每组作业都从相同的初始布局开始
+                
+                start = get_time_seconds();
+                if (batch) {
+                    allocate_batch(&mix[r * jobs], jobs, results);
+                } else {
+                    for (int j = 0; j < jobs; j++) {
+                        results[j] = allocate_memory(mix[r * jobs + j], 1);
+                    }
+                }
+                elapsed += get_time_seconds() - start;
+                
+                for (int j = 0; j < jobs; j++) {
+                    demanded_kb += mix[r * jobs + j].size;
+                    if (results[j]) {
+                        admitted++;
+                        admitted_kb += mix[r * jobs + j].size;
+                    }
+                }
+                
+                collect_fragmentation(&free_total, &largest_free, &internal);
+                fragmentation += external_fragmentation(free_total, largest_free);
+            }
+            
+            printf("| %-12s | %-4s | %6.2f%% | %11.2f%% | %-13.0f | %13.1f%% |\n",
+                   algorithm_name(policies[i]), batch ? "批量" : "逐个",
+                   100.0 * admitted / (rounds * jobs), 100.0 * admitted_kb / demanded_kb,
+                   admitted / elapsed, 100.0 * fragmentation / rounds);
+        }
+    }
+    printf("------------------------------------------------------------------------------------\n");
+    
+    free(mix);
+    free(results);
+    clear_memory_list();
+}
+
+/**
+ * 比较启用前端缓存前后的可变分区算法：负载中大部分请求集中在少数几个重复的大小上，
+ * 统计吞吐量、缓存命中率、分配失败次数、缓存清空次数和外部碎片率
+ */
+void benchmark_front_cache() {
+    int ops = 200000;          // 分配操作次数
+    int max_lifetime = 64;     // 进程存活的最大操作数
+    int policies[] = {FIRST_FIT, BEST_FIT, WORST_FIT, NEXT_FIT};
+    long long common_sizes[] = {4, 16, 24, 64, 128};  // 重复出现的请求大小(KB)
+    Request *allocs = (Request *)malloc(sizeof(Request) * ops);
+    int *release_head = (int *)malloc(sizeof(int) * (ops + max_lifetime + 1)); // 每次操作后要释放的进程链表头
+    int *release_next = (int *)malloc(sizeof(int) * ops);
+    
+    if (!allocs || !release_head || !release_next) {
+        printf("内存分配失败！\n");
+        exit(1);
+    }
+    
+    // 生成负载：90%的请求取自几个常见大小，其余在1~256KB之间均匀分布，存活1~max_lifetime次操作
+    srand(1);
+    for (int i = 0; i < ops + max_lifetime + 1; i++) {
+        release_head[i] = -1;
+    }
+    for (int i = 0; i < ops; i++) {
+        int release_at = i + 1 + rand() % max_lifetime;
+        
+        sprintf(allocs[i].process_name, "P%d", i);
+        if (rand() % 10 < 9) {
+            allocs[i].size = common_sizes[rand() % (int)(sizeof(common_sizes) / sizeof(common_sizes[0]))];
+        } else {
+            allocs[i].size = 1 + rand() % 256;
+        }
+        release_next[i] = release_head[release_at];
+        release_head[release_at] = i;
+    }
+    
+    total_memory_size = 8 * 1024;
+    
+    printf("\n前端缓存对比测试（%d次分配，90%%的请求为常见大小，总内存%lldKB）\n", ops, total_memory_size);
+    printf("------------------------------------------------------------------------------------------------\n");
+    printf("| 算法         | 缓存 | 吞吐量(操作/秒) | 命中率  | 分配失败 | 缓存清空次数 | 平均外部碎片率 |\n");
+    printf("------------------------------------------------------------------------------------------------\n");
+    
+    for (int i = 0; i < (int)(sizeof(policies) / sizeof(policies[0])); i++) {
+        for (int cached = 0; cached <= 1; cached++) {
+            int failures = 0;
+            long long free_total, largest_free, internal;
+            double start, elapsed, fragmentation = 0;
+            
+            build_memory_segments(2);  // 每种算法从相同的初始布局开始
+            algorithm = policies[i];
+            front_cache_enabled = cached;
+            front_cache_hits = 0;
+            front_cache_misses = 0;
+            front_cache_flushes = 0;
+            
+            start = get_time_seconds();
+            for (int t = 0; t < ops; t++) {
+                if (!allocate_memory(allocs[t], 1)) {
+                    failures++;
+                }
+                for (int r = release_head[t]; r != -1; r = release_next[r]) {
+                    release_memory(allocs[r].process_name);
+                }
+                
+                // 每1000次操作采样一次外部碎片率（采样耗时很短，不单独扣除）
+                if (t % 1000 == 999) {
+                    collect_fragmentation(&free_total, &largest_free, &internal);
+                    fragmentation += external_fragmentation(free_total, largest_free);
+                }
+            }
+            elapsed = get_time_seconds() - start;
+            
+            printf("| %-12s | %-4s | %-15.0f | %6.2f%% | %-8d | %-12d | %13.1f%% |\n",
+                   algorithm_name(policies[i]), cached ? "开启" : "关闭", ops / elapsed,
+                   front_cache_hits + front_cache_misses > 0 ?
+                       100.0 * front_cache_hits / (front_cache_hits + front_cache_misses) : 0.0,
+                   failures, front_cache_flushes, 100.0 * fragmentation / (ops / 1000));
+        }
+    }
+    printf("------------------------------------------------------------------------------------------------\n");
+    front_cache_enabled = 0;
+    
+    free(allocs);
+    free(release_head);
+    free(release_next);
+    clear_memory_list();
+}
+
+/**
+ * 比较立即合并与延迟合并：同一负载下分别用立即合并和几种扫描阈值的延迟合并运行可变分区算法，
+ * 统计吞吐量、分配失败次数、合并扫描次数、平均空闲块数和平均外部碎片率
+ * 负载中大部分请求集中在少数几个重复的大小上，未合并的空闲分区常常被同样大小的请求直接复用
+ */
+void benchmark_lazy_coalesce() {
+    int ops = 200000;          // 分配操作次数
+    int max_lifetime = 64;     // 进程存活的最大操作数
+    int policies[] = {FIRST_FIT, BEST_FIT, WORST_FIT, NEXT_FIT};
+    int thresholds[] = {0, 16, 256, 4096};  // 扫描阈值，0表示立即合并
+    long long common_sizes[] = {4, 16, 24, 64, 128};  // 重复出现的请求大小(KB)
+    Request *allocs = (Request *)malloc(sizeof(Request) * ops);
+    int *release_head = (int *)malloc(sizeof(int) * (ops + max_lifetime + 1)); // 每次操作后要释放的进程链表头
+    int *release_next = (int *)malloc(sizeof(int) * ops);
+    
+    if (!allocs || !release_head || !release_next) {
+        printf("内存分配失败！\n");
+        exit(1);
+    }
+    
+    // 生成负载：90%的请求取自几个常见大小，其余在1~256KB之间均匀分布，存活1~max_lifetime次操作
+    srand(1);
+    for (int i = 0; i < ops + max_lifetime + 1; i++) {
+        release_head[i] = -1;
+    }
+    for (int i = 0; i < ops; i++) {
+        int release_at = i + 1 + rand() % max_lifetime;
+        
+        sprintf(allocs[i].process_name, "P%d", i);
+        if (rand() % 10 < 9) {
+            allocs[i].size = common_sizes[rand() % (int)(sizeof(common_sizes) / sizeof(common_sizes[0]))];
+        } else {
+            allocs[i].size = 1 + rand() % 256;
+        }
+        release_next[i] = release_head[release_at];
+        release_head[release_at] = i;
+    }
+    
+    total_memory_size = 8 * 1024;
+    
+    printf("\n立即合并与延迟合并对比测试（%d次分配，90%%的请求为常见大小，总内存%lldKB）\n", ops, total_memory_size);
+    printf("--------------------------------------------------------------------------------------------------\n");
+    printf("| 算法         | 合并方式     | 吞吐量(操作/秒) | 分配失败 | 合并扫描次数 | 平均空闲块数 | 平均外部碎片率 |\n");
+    printf("--------------------------------------------------------------------------------------------------\n");
+    
+    for (int i = 0; i < (int)(sizeof(policies) / sizeof(policies[0])); i++) {
+        for (int k = 0; k < (int)(sizeof(thresholds) / sizeof(thresholds[0])); k++) {
+            int failures = 0;
+            long long free_total, largest_free, internal, holes = 0;
+            double start, elapsed, fragmentation = 0;
+            char mode[32];
+            
+            build_memory_segments(2);  // 每种设置从相同的初始布局开始
+            algorithm = policies[i];
+            lazy_coalesce_enabled = thresholds[k] > 0;
+            lazy_coalesce_threshold = thresholds[k] > 0 ? thresholds[k] : LAZY_COALESCE_THRESHOLD;
+            lazy_sweeps = 0;
+            
+            start = get_time_seconds();
+            for (int t = 0; t < ops; t++) {
+                if (!allocate_memory(allocs[t], 1)) {
+                    failures++;
+                }
+                for (int r = release_head[t]; r != -1; r = release_next[r]) {
+                    release_memory(allocs[r].process_name);
+                }
+                
+                // 每1000次操作采样一次空闲块数和外部碎片率（采样耗时很短，不单独扣除）
+                if (t % 1000 == 999) {
+                    collect_fragmentation(&free_total, &largest_free, &internal);
+                    fragmentation += external_fragmentation(free_total, largest_free);
+                    holes += free_partition_count;
+                }
+            }
+            elapsed = get_time_seconds() - start;
+            
+            if (thresholds[k] > 0) {
+                sprintf(mode, "延迟(%d)", thresholds[k]);
+            } else {
+                sprintf(mode, "立即");
+            }
+            printf("| %-12s | %-12s | %-15.0f | %-8d | %-12d | %-12lld | %13.1f%% |\n",
+                   algorithm_name(policies[i]), mode, ops / elapsed, failures, lazy_sweeps,
+                   holes / (ops / 1000), 100.0 * fragmentation / (ops / 1000));
+        }
+    }
+    printf("--------------------------------------------------------------------------------------------------\n");
+    lazy_coalesce_enabled = 0;
+    lazy_coalesce_threshold = LAZY_COALESCE_THRESHOLD;
+    
+    free(allocs);
+    free(release_head);
+    free(release_next);
+    clear_memory_list();
+}
+
+unsigned long long bench_random_state = 1;  // 性能测试负载生成器的状态
+
+/**
+ * 64位随机数生成器（xorshift64*）前进一步，范围和周期都比rand()大
+ * @param state 生成器状态，不能为0
+ * @return 64位随机数
+ */
+unsigned long long xorshift_next(unsigned long long *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+/**
+ * 性能测试负载的随机数生成器
+ * @return 64位随机数
+ */
+unsigned long long bench_random() {
+    return xorshift_next(&bench_random_state);
+}
+
+/**
+ * 生成(0, 1)区间内均匀分布的随机数
+ */
+double bench_uniform() {
+    return ((bench_random() >> 11) + 0.5) / 9007199254740992.0;  // 53位精度
+}
+
+/**
+ * 按指定分布生成一个随机数，各分布的均值都约为mean
+ * 用于请求大小，也用于合成负载中进程的存活时间
+ * @param distribution 分布类型
+ * @param mean 均值
+ * @return 随机数（非负）
+ */
+double sample_distribution(int distribution, double mean) {
+    double value;
+    
+    switch (distribution) {
+        case DIST_EXPONENTIAL:
+            value = -mean * log(bench_uniform());
+            break;
+        case DIST_BIMODAL:
+            // 80%的较小值均值为mean/8，20%的较大值在[4mean, 5mean]之间，总均值约为mean
+            if (bench_uniform() < 0.8) {
+                value = bench_uniform() * mean / 4;
+            } else {
+                value = mean * (4 + bench_uniform());
+            }
+            break;
+        case DIST_POWERLAW:
+            // 帕累托分布，形状参数1.5，均值为3倍的最小值
+            value = (mean / 3.0) * pow(bench_uniform(), -1 / 1.5);
+            break;
+        default:  // DIST_UNIFORM
+            value = bench_uniform() * 2 * mean;
+    }
+    return value;
+}
+
+/**
+ * 按指定分布生成一个请求大小，各分布的均值都约为mean
+ * @param distribution 分布类型
+ * @param mean 平均请求大小(KB)
+ * @return 请求大小(KB)，至少为1，不超过总内存的1/4
+ */
+long long sample_request_size(int distribution, long long mean) {
+    double size = sample_distribution(distribution, (double)mean);
+    
+    if (size < 1) {
+        size = 1;
+    }
+    if (size > total_memory_size / 4) {
+        size = (double)(total_memory_size / 4);  // 截断长尾，避免出现不可能满足的请求
+    }
+    return (long long)size;
+}
+
+/**
+ * 生成性能测试负载：请求大小服从指定分布，进程存活的分配次数服从指数分布
+ * @param w 输出的负载
+ * @param distribution 请求大小分布
+ * @param ops 分配次数
+ * @param mean_lifetime 进程平均存活的分配次数
+ * @param mean_size 平均请求大小(KB)
+ */
+void generate_workload(Workload *w, int distribution, int ops, int mean_lifetime, long long mean_size) {
+    w->ops = ops;
+    w->allocs = (Request *)malloc(sizeof(Request) * ops);
+    w->release_head = (int *)malloc(sizeof(int) * ops);
+    w->release_next = (int *)malloc(sizeof(int) * ops);
+    if (!w->allocs || !w->release_head || !w->release_next) {
+        printf("内存分配失败！\n");
+        exit(1);
+    }
+    
+    bench_random_state = 0x9E3779B97F4A7C15ULL + distribution;  // 每种分布的负载固定
+    for (int t = 0; t < ops; t++) {
+        w->release_head[t] = -1;
+    }
+    for (int t = 0; t < ops; t++) {
+        long long release = t + 1 + (long long)(-mean_lifetime * log(bench_uniform()));
+        
+        sprintf(w->allocs[t].process_name, "P%d", t);
+        w->allocs[t].size = sample_request_size(distribution, mean_size);
+        
+        // 在测试结束之后才释放的进程不需要记录
+        w->release_next[t] = -1;
+        if (release < ops) {
+            w->release_next[t] = w->release_head[release];
+            w->release_head[release] = t;
+        }
+    }
+}
+
+/**
+ * 释放负载占用的内存
+ */
+void free_workload(Workload *w) {
+    free(w->allocs);
+    free(w->release_head);
+    free(w->release_next);
+}
+
+/**
+ * 把最小堆中位置i的元素向上调整到合适的位置
+ * @param heap 按释放时间排序的最小堆
+ * @param i 新加入元素的下标
+ */
+void pending_sift_up(PendingFree *heap, long long i) {
+    PendingFree item = heap[i];
+    
+    while (i > 0 && heap[(i - 1) / 2].time > item.time) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = item;
+}
+
+/**
+ * 取出最小堆的堆顶（释放时间最早的进程）
+ * @param heap 最小堆
+ * @param count 堆中的元素数，取出后减1
+ */
+PendingFree pending_pop(PendingFree *heap, long long *count) {
+    PendingFree top = heap[0];
+    PendingFree item = heap[--*count];
+    long long i = 0;
+    
+    while (2 * i + 1 < *count) {
+        long long child = 2 * i + 1;
+        
+        if (child + 1 < *count && heap[child + 1].time < heap[child].time) {
+            child++;
+        }
+        if (heap[child].time >= item.time) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    if (*count > 0) {
+        heap[i] = item;
+    }
+    return top;
+}
+
+/**
+ * 按进程的局部性模型生成一次页面访问
+ * @param p 进程的页面访问状态
+ * @param page_size 页面大小（字节）
+ * @param rec 输出的访问记录
+ */
+void generate_access(GeneratorProcess *p, int page_size, TraceRecord *rec) {
+    const char operations[] = {'+', '-', 'x', '/', 'l'};  // 读操作，与请求式分页程序的指令相同
+    int window_pages = p->pages > 4 ? p->pages / 4 : 1;    // 工作集窗口的页面数
+    int loop_pages = p->pages > 2 ? p->pages / 2 : 1;      // 循环模型访问的页面数
+    int page;
+    
+    switch (p->locality) {
+        case LOCALITY_WORKING_SET:
+            // 阶段变化：窗口偶尔整体移到进程页面中的新位置
+            if (bench_random() % WORKING_SET_PHASE_LENGTH == 0) {
+                p->window = (int)(bench_random() % (p->pages - window_pages + 1));
+            }
+            page = p->window + (int)(bench_random() % window_pages);
+            break;
+        case LOCALITY_LOOP:
+            page = p->cursor++ % loop_pages;
+            break;
+        default:  // LOCALITY_SEQUENTIAL
+            page = p->cursor++ % p->pages;
+    }
+    
+    rec->type = TRACE_ACCESS;
+    rec->operation = bench_random() % 4 == 0 ? 's' : operations[bench_random() % sizeof(operations)];  // 约1/4为写
+    rec->data.access.page_number = p->base + page;
+    rec->data.access.offset = (int)(bench_random() % page_size);
+}
+
+/**
+ * 生成合成负载并写成二进制轨迹文件：
+ * 进程按泊松过程到达，每个进程到达时申请一次内存，存活时间到期后释放；
+ * 每次到达后随机选一个存活的进程，按其局部性模型连续访问若干页面。
+ * 记录按时间顺序写出，文件头中的记录数在写完后补上
+ * @param path 输出文件路径
+ * @param spec 生成器参数
+ * @return 1-成功，0-失败
+ */
+int generate_trace(const char *path, const GeneratorSpec *spec) {
+    FILE *fp = fopen(path, "wb");
+    TraceHeader h;
+    TraceRecord rec;
+    GeneratorProcess *procs = (GeneratorProcess *)malloc(sizeof(GeneratorProcess) * (spec->processes + 1));
+    PendingFree *heap = (PendingFree *)malloc(sizeof(PendingFree) * (spec->processes + 1));
+    unsigned int *live = (unsigned int *)malloc(sizeof(unsigned int) * (spec->processes + 1));  // 存活进程的进程号
+    long long *live_pos = (long long *)malloc(sizeof(long long) * (spec->processes + 1));       // 进程在live中的下标
+    long long heap_count = 0, live_count = 0, records = 0;
+    double now = 0;
+    int ok;
+    
+    if (!fp) {
+        printf("无法创建轨迹文件: %s\n", path);
+        free(procs);
+        free(heap);
+        free(live);
+        free(live_pos);
+        return 0;
+    }
+    if (!procs || !heap || !live || !live_pos) {
+        printf("内存分配失败！\n");
+        exit(1);
+    }
+    
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, TRACE_MAGIC, sizeof(h.magic));
+    h.version = TRACE_VERSION;
+    h.process_count = spec->processes;
+    h.page_count = spec->page_count;
+    h.page_size = spec->page_size;
+    fwrite(&h, sizeof(h), 1, fp);  // 记录数先写0，最后补上
+    
+    memset(&rec, 0, sizeof(rec));
+    bench_random_state = spec->seed ? spec->seed : 1;
+    for (unsigned int id = 1; id <= spec->processes; id++) {
+        GeneratorProcess *p = &procs[id];
+        
+        now += -log(bench_uniform()) / spec->arrival_rate;  // 指数分布的到达间隔
+        
+        // 先写出在本次到达之前到期的释放
+        while (heap_count > 0 && heap[0].time <= now) {
+            PendingFree f = pending_pop(heap, &heap_count);
+            long long i = live_pos[f.process_id];
+            
+            rec.time = f.time;
+            rec.process_id = f.process_id;
+            rec.type = TRACE_FREE;
+            rec.operation = 0;
+            rec.data.size = 0;
+            fwrite(&rec, sizeof(rec), 1, fp);
+            records++;
+            live[i] = live[--live_count];  // 用最后一个存活进程填补空位
+            live_pos[live[i]] = i;
+        }
+        
+        rec.time = now;
+        rec.process_id = id;
+        rec.type = TRACE_ALLOC;
+        rec.operation = 0;
+        rec.data.size = sample_request_size(spec->size_distribution, spec->mean_size);
+        fwrite(&rec, sizeof(rec), 1, fp);
+        records++;
+        
+        // 进程的页面数与申请的内存大小相当，不超过页号范围
+        p->pages = (int)(rec.data.size * 1024 / spec->page_size);
+        if (p->pages < 1) {
+            p->pages = 1;
+        }
+        if (p->pages > spec->page_count) {
+            p->pages = spec->page_count;
+        }
+        p->base = (int)(bench_random() % (spec->page_count - p->pages + 1));
+        p->locality = spec->locality == LOCALITY_MIXED ? (int)(bench_random() % LOCALITY_COUNT) : spec->locality;
+        p->window = 0;
+        p->cursor = 0;
+        live_pos[id] = live_count;
+        live[live_count++] = id;
+        heap[heap_count].time = now + sample_distribution(spec->lifetime_distribution, spec->mean_lifetime) / spec->arrival_rate;
+        heap[heap_count].process_id = id;
+        pending_sift_up(heap, heap_count++);
+        
+        // 随机选一个存活的进程，按其局部性模型连续访问若干页面
+        if (spec->refs_per_arrival > 0) {
+            unsigned int runner = live[bench_random() % live_count];
+            
+            rec.process_id = runner;
+            for (int k = 0; k < spec->refs_per_arrival; k++) {
+                generate_access(&procs[runner], spec->page_size, &rec);
+                fwrite(&rec, sizeof(rec), 1, fp);
+                records++;
+            }
+        }
+    }
+    
+    // 最后释放仍然存活的进程，每个分配都有对应的释放
+    while (heap_count > 0) {
+        PendingFree f = pending_pop(heap, &heap_count);
+        
+        rec.time = f.time;
+        rec.process_id = f.process_id;
+        rec.type = TRACE_FREE;
+        rec.operation = 0;
+        rec.data.size = 0;
+        fwrite(&rec, sizeof(rec), 1, fp);
+        records++;
+    }
+    
+    h.record_count = records;
+    fseek(fp, 0, SEEK_SET);
+    fwrite(&h, sizeof(h), 1, fp);
+    ok = !ferror(fp);
+    if (fclose(fp) != 0) {
+        ok = 0;
+    }
+    if (!ok) {
+        printf("写入轨迹文件失败: %s\n", path);
+    }
+    
+    free(procs);
+    free(heap);
+    free(live);
+    free(live_pos);
+    return ok;
+}
+
+/**
+ * 比较两个延迟值，用于qsort排序求分位数
+ */
+int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * 在多种请求大小分布下比较各分配算法：
+ * 每种分布生成一份固定负载，每种算法从相同的初始布局（或同一个快照）开始执行，
+ * 输出吞吐量、分配延迟的平均值/p50/p99/最大值、单次释放的最大延迟、分配失败率，以及外部碎片率随时间的变化
+ * （最大延迟反映各算法的最坏情况，对需要延迟上界的场合比平均值更重要）
+ * @param distribution 负载分布，-1表示全部
+ * @param ops 分配次数
+ * @param mean_lifetime 进程平均存活的分配次数
+ * @param mean_size 平均请求大小(KB)，0表示使平均占用约为总内存的70%
+ */
+void benchmark_suite(int distribution, int ops, int mean_lifetime, long long mean_size) {
+    const char *titles[DIST_COUNT] = {"均匀分布", "指数分布", "双峰分布", "幂律分布"};
+    int policies[] = {FIRST_FIT, BEST_FIT, WORST_FIT, NEXT_FIT, BUDDY_SYSTEM, BITMAP_SYSTEM, TLSF_SYSTEM};
+    int policy_count = (int)(sizeof(policies) / sizeof(policies[0]));
+    double *latencies = (double *)malloc(sizeof(double) * ops);  // 每次分配的耗时（秒）
+    double samples[sizeof(policies) / sizeof(policies[0])][FRAGMENTATION_SAMPLES];  // 外部碎片率采样
+    
+    if (!latencies) {
+        printf("内存分配失败！\n");
+        exit(1);
+    }
+    // 从快照开始时总内存大小以快照为准
+    if (start_snapshot && !load_snapshot(start_snapshot)) {
+        free(latencies);
+        return;
+    }
+    if (mean_size == 0) {
+        mean_size = (long long)((double)total_memory_size * 0.7 / mean_lifetime);
+        if (mean_size < 1) {
+            mean_size = 1;
+        }
+    }
+    
+    for (int d = 0; d < DIST_COUNT; d++) {
+        Workload w;
+        
+        if (distribution >= 0 && d != distribution) {
+            continue;
+        }
+        generate_workload(&w, d, ops, mean_lifetime, mean_size);
+#ifdef ALLOC_PROFILE
+        profile_reset();  // 每种分布单独输出延迟直方图
+#endif
+        
+        printf("\n%s负载（%d次分配，平均大小%lldKB，平均存活%d次分配，总内存%lldKB，紧凑%s）\n",
+               titles[d], ops, mean_size, mean_lifetime, total_memory_size,
+               compaction_enabled ? "开启" : "关闭");
+        printf("------------------------------------------------------------------------------------------------------------------------------------\n");
+        printf("| 算法         | 吞吐量(操作/秒) | 分配平均(ns) | 分配p50(ns) | 分配p99(ns) | 分配最大(ns) | 释放最大(ns) | 失败率  | 最终外部碎片率 |\n");
+        printf("------------------------------------------------------------------------------------------------------------------------------------\n");
+        
+        for (int i = 0; i < policy_count; i++) {
+            int failures = 0;
+            long long free_total, largest_free, internal;
+            double elapsed = 0;
+            double alloc_total = 0;      // 分配的累计耗时（秒）
+            double release_max = 0;      // 单个进程释放的最大耗时（秒）
+            
+            // 每种算法从相同的初始状态开始：指定了快照时从快照恢复，否则按固定种子生成布局
+            if (start_snapshot) {
+                load_snapshot(start_snapshot);  // 开始时已检查过快照文件
+            } else {
+                build_memory_segments(2);
+            }
+            algorithm = policies[i];
+            
+            for (int t = 0; t < ops; t++) {
+                double start = get_time_seconds();
+                double alloc_end;
+                
+                if (!allocate_memory(w.allocs[t], 1)) {
+                    failures++;
+                }
+                alloc_end = get_time_seconds();
+                latencies[t] = alloc_end - start;
+                alloc_total += latencies[t];
+                
+                for (int r = w.release_head[t]; r != -1; r = w.release_next[r]) {
+                    double release_start = get_time_seconds();
+                    double release_time;
+                    
+                    release_memory(w.allocs[r].process_name);
+                    release_time = get_time_seconds() - release_start;
+                    if (release_time > release_max) {
+                        release_max = release_time;
+                    }
+                }
+                elapsed += get_time_seconds() - start;
+                
+                // 每完成1/FRAGMENTATION_SAMPLES的负载采样一次外部碎片率（不计入耗时）
+                if ((long long)(t + 1) * FRAGMENTATION_SAMPLES % ops < FRAGMENTATION_SAMPLES) {
+                    int k = (int)((long long)(t + 1) * FRAGMENTATION_SAMPLES / ops) - 1;
+                    if (k >= 0 && k < FRAGMENTATION_SAMPLES) {
+                        collect_fragmentation(&free_total, &largest_free, &internal);
+                        samples[i][k] = external_fragmentation(free_total, largest_free);
+                    }
+                }
+            }
+            
+            qsort(latencies, ops, sizeof(double), compare_doubles);
+            printf("| %-12s | %-15.0f | %-12.0f | %-11.0f | %-11.0f | %-12.0f | %-12.0f | %6.2f%% | %13.1f%% |\n",
+                   algorithm_name(policies[i]), 2.0 * ops / elapsed, alloc_total / ops * 1e9,
+                   latencies[ops / 2] * 1e9, latencies[(int)(ops * 0.99)] * 1e9, latencies[ops - 1] * 1e9,
+                   release_max * 1e9, 100.0 * failures / ops, samples[i][FRAGMENTATION_SAMPLES - 1] * 100);
+        }
+        printf("------------------------------------------------------------------------------------------------------------------------------------\n");
+        
+        // 外部碎片率随时间的变化：按负载进度（10%, 20%, ...）采样
+        printf("外部碎片率随负载进度的变化：\n");
+        printf("| 算法         |");
+        for (int k = 0; k < FRAGMENTATION_SAMPLES; k++) {
+            printf(" %4d%% |", (k + 1) * 100 / FRAGMENTATION_SAMPLES);
+        }
+        printf("\n");
+        for (int i = 0; i < policy_count; i++) {
+            printf("| %-12s |", algorithm_name(policies[i]));
+            for (int k = 0; k < FRAGMENTATION_SAMPLES; k++) {
+                printf(" %4.1f%% |", samples[i][k] * 100);
+            }
+            printf("\n");
+        }
+#ifdef ALLOC_PROFILE
+        profile_report();
+#endif
+        
+        free_workload(&w);
+    }
+    
+    free(latencies);
+    clear_memory_list();
+}
+
+/**
+ * 执行负载中第from到第to-1次分配，以及每次分配后到期的释放
+ * @return 分配失败次数
+ */
+int run_workload_range(Workload *w, int from, int to) {
+    int failures = 0;
+    
+    for (int t = from; t < to; t++) {
+        if (!allocate_memory(w->allocs[t], 1)) {
+            failures++;
+        }
+        for (int r = w->release_head[t]; r != -1; r = w->release_next[r]) {
+            release_memory(w->allocs[r].process_name);
+        }
+    }
+    return failures;
+}
+
+#ifdef ALLOC_PROFILE
+/**
+ * 读取计时器的周期数：x86上的GCC/MinGW直接读时间戳计数器（rdtsc），开销只有几十个周期，
+ * 其他情况使用QueryPerformanceCounter
+ */
+unsigned long long profile_ticks() {
+#ifdef FIT_SIMD_X86
+    return __builtin_ia32_rdtsc();
+#else
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (unsigned long long)counter.QuadPart;
+#endif
+}
+
+/**
+ * 开始一次计时，同时清零查找访问的节点数
+ * 外层的allocate_memory清零后，内层的find_free_partition会再清零一次，记录的只是查找本身访问的节点
+ * @return 开始时的周期数
+ */
+unsigned long long profile_begin() {
+    profile_nodes_visited = 0;
+    return profile_ticks();
+}
+
+/**
+ * 计算数值所在的桶：小于2^PROFILE_SUB_SHIFT的数值各占一个桶，
+ * 更大的数值按最高位所在的2的幂区间分组，每组再按最高位之后的PROFILE_SUB_SHIFT位等分
+ */
+int histogram_bucket(unsigned long long value) {
+    int msb;
+    
+    if (value < (1ULL << PROFILE_SUB_SHIFT)) {
+        return (int)value;
+    }
+    msb = 63 - bitmap_clz(value);
+    return ((msb - PROFILE_SUB_SHIFT + 1) << PROFILE_SUB_SHIFT) +
+           (int)((value >> (msb - PROFILE_SUB_SHIFT)) & ((1ULL << PROFILE_SUB_SHIFT) - 1));
+}
+
+/**
+ * 求桶中最大的数值，分位数取所在桶的上界
+ */
+unsigned long long histogram_bucket_upper(int bucket) {
+    int msb, sub;
+    
+    if (bucket < (1 << PROFILE_SUB_SHIFT)) {
+        return (unsigned long long)bucket;
+    }
+    msb = (bucket >> PROFILE_SUB_SHIFT) + PROFILE_SUB_SHIFT - 1;
+    sub = bucket & ((1 << PROFILE_SUB_SHIFT) - 1);
+    return ((((1ULL << PROFILE_SUB_SHIFT) + sub) << (msb - PROFILE_SUB_SHIFT)) - 1) +
+           (1ULL << (msb - PROFILE_SUB_SHIFT));
+}
+
+/**
+ * 向直方图中加入一个数值
+ */
+void histogram_add(Histogram *h, unsigned long long value) {
+    h->count++;
+    h->total += value;
+    if (value > h->max) {
+        h->max = value;
+    }
+    h->buckets[histogram_bucket(value)]++;
+}
+
+/**
+ * 求直方图的分位数：从小到大累计各桶的次数，取累计到q的那个桶的上界（不超过最大值）
+ * @param q 分位（0~1）
+ */
+unsigned long long histogram_percentile(const Histogram *h, double q) {
+    long long rank = (long long)(q * h->count);
+    long long seen = 0;
+    
+    for (int b = 0; b < PROFILE_BUCKETS; b++) {
+        seen += h->buckets[b];
+        if (seen > rank) {
+            unsigned long long upper = histogram_bucket_upper(b);
+            return upper < h->max ? upper : h->max;
+        }
+    }
+    return h->max;
+}
+
+/**
+ * 把一次调用的耗时记入当前算法的直方图；查找还记录这次访问的节点数
+ * @param op 操作（PROFILE_ALLOCATE等）
+ * @param ticks 耗时（计时器周期）
+ */
+void profile_record(int op, unsigned long long ticks) {
+    histogram_add(&profile_latency[op][algorithm], ticks);
+    if (op == PROFILE_SEARCH) {
+        histogram_add(&profile_visits[algorithm], (unsigned long long)profile_nodes_visited);
+    }
+}
+
+/**
+ * 清空全部延迟直方图
+ */
+void profile_reset() {
+    memset(profile_latency, 0, sizeof(profile_latency));
+    memset(profile_visits, 0, sizeof(profile_visits));
+}
+
+/**
+ * 把计时器周期换算为纳秒：首次调用时用高精度计时器对照10ms校准计时器频率
+ */
+double profile_ticks_to_ns(unsigned long long ticks) {
+    if (profile_ticks_per_ns == 0) {
+        double start = get_time_seconds();
+        unsigned long long start_ticks = profile_ticks();
+        double elapsed;
+        
+        do {
+            elapsed = get_time_seconds() - start;
+        } while (elapsed < 0.01);
+        profile_ticks_per_ns = (profile_ticks() - start_ticks) / (elapsed * 1e9);
+    }
+    return ticks / profile_ticks_per_ns;
+}
+
+/**
+ * 输出各操作、各算法的延迟分位数，以及各算法每次查找访问的节点数
+ * 只输出有记录的行；伙伴系统、位图分配和TLSF不经过find_free_partition，没有查找的记录
+ */
+void profile_report() {
+    const char *op_names[PROFILE_OP_COUNT] = {"allocate_memory", "find_free_partition",
+                                              "release_memory", "merge_free_partitions"};
+    
+    printf("\n分配器延迟直方图（对数分桶，分位数为所在桶的上界）\n");
+    printf("----------------------------------------------------------------------------------------------------------------------\n");
+    printf("| 操作                  | 算法         | 次数       | 平均(ns)  | p50(ns)   | p90(ns)   | p99(ns)   | 最大(ns)     |\n");
+    printf("----------------------------------------------------------------------------------------------------------------------\n");
+    for (int op = 0; op < PROFILE_OP_COUNT; op++) {
+        for (int alg = FIRST_FIT; alg <= TLSF_SYSTEM; alg++) {
+            const Histogram *h = &profile_latency[op][alg];
+            
+            if (h->count == 0) {
+                continue;
+            }
+            printf("| %-21s | %-12s | %-10lld | %-9.0f | %-9.0f | %-9.0f | %-9.0f | %-12.0f |\n",
+                   op_names[op], algorithm_name(alg), h->count,
+                   profile_ticks_to_ns(h->total) / h->count,
+                   profile_ticks_to_ns(histogram_percentile(h, 0.5)),
+                   profile_ticks_to_ns(histogram_percentile(h, 0.9)),
+                   profile_ticks_to_ns(histogram_percentile(h, 0.99)),
+                   profile_ticks_to_ns(h->max));
+        }
+    }
+    printf("----------------------------------------------------------------------------------------------------------------------\n");
+    
+    printf("每次查找访问的节点数（最先适应为空闲分区，循环首次适应为链表节点，最佳/最坏适应为平衡树节点）\n");
+    printf("----------------------------------------------------------------------------------\n");
+    printf("| 算法         | 查找次数   | 平均      | p50       | p90       | p99       | 最大      |\n");
+    printf("----------------------------------------------------------------------------------\n");
+    for (int alg = FIRST_FIT; alg <= TLSF_SYSTEM; alg++) {
+        const Histogram *h = &profile_visits[alg];
+        
+        if (h->count == 0) {
+            continue;
+        }
+        printf("| %-12s | %-10lld | %-9.1f | %-9llu | %-9llu | %-9llu | %-9llu |\n",
+               algorithm_name(alg), h->count, (double)h->total / h->count,
+               histogram_percentile(h, 0.5), histogram_percentile(h, 0.9),
+               histogram_percentile(h, 0.99), h->max);
+    }
+    printf("----------------------------------------------------------------------------------\n");
+}
+
+/**
+ * 比较各算法的延迟分布和查找访问的节点数随内存大小的变化：
+ * 平均请求大小固定，进程平均存活的分配次数与内存大小成正比（平均占用约为总内存的70%），
+ * 内存越大同时存在的分区和空闲块越多，从中可以看出哪些算法的查找随堆的大小变慢
+ */
+void benchmark_profile() {
+    long long memory_sizes[] = {1024, 8 * 1024, 64 * 1024, 512 * 1024};  // 总内存大小(KB)
+    int policies[] = {FIRST_FIT, BEST_FIT, WORST_FIT, NEXT_FIT, BUDDY_SYSTEM, BITMAP_SYSTEM, TLSF_SYSTEM};
+    long long mean_size = 16;  // 平均请求大小(KB)
+    long long saved_memory_size = total_memory_size;
+    
+    for (int m = 0; m < (int)(sizeof(memory_sizes) / sizeof(memory_sizes[0])); m++) {
+        Workload w;
+        int mean_lifetime, ops;
+        
+        total_memory_size = memory_sizes[m];
+        mean_lifetime = (int)(total_memory_size * 0.7 / mean_size);
+        ops = mean_lifetime * 4 > 50000 ? mean_lifetime * 4 : 50000;  // 足够进入稳定状态
+        generate_workload(&w, DIST_EXPONENTIAL, ops, mean_lifetime, mean_size);
+        
+        printf("\n总内存%lldKB（指数分布，%d次分配，平均大小%lldKB，平均存活%d次分配）\n",
+               total_memory_size, ops, mean_size, mean_lifetime);
+        printf("-----------------------------------------------------------------------------------------------------------------------------\n");
+        printf("| 算法         | 分配p50(ns) | 分配p99(ns) | 分配最大(ns) | 查找p50(ns) | 查找p99(ns) | 访问节点平均 | 访问节点p99 | 释放p99(ns) |\n");
+        printf("-----------------------------------------------------------------------------------------------------------------------------\n");
+        for (int i = 0; i < (int)(sizeof(policies) / sizeof(policies[0])); i++) {
+            int alg = policies[i];
+            const Histogram *a = &profile_latency[PROFILE_ALLOCATE][alg];
+            const Histogram *s = &profile_latency[PROFILE_SEARCH][alg];
+            const Histogram *v = &profile_visits[alg];
+            const Histogram *r = &profile_latency[PROFILE_RELEASE][alg];
+            
+            build_memory_segments(2);  // 每种算法从相同的初始布局开始
+            algorithm = alg;
+            profile_reset();
+            run_workload_range(&w, 0, ops);
+            
+            // 伙伴系统、位图分配和TLSF没有经过find_free_partition的查找
+            if (s->count > 0) {
+                printf("| %-12s | %-11.0f | %-11.0f | %-12.0f | %-11.0f | %-11.0f | %-12.1f | %-11llu | %-11.0f |\n",
+                       algorithm_name(alg),
+                       profile_ticks_to_ns(histogram_percentile(a, 0.5)),
+                       profile_ticks_to_ns(histogram_percentile(a, 0.99)), profile_ticks_to_ns(a->max),
+                       profile_ticks_to_ns(histogram_percentile(s, 0.5)),
+                       profile_ticks_to_ns(histogram_percentile(s, 0.99)),
+                       (double)v->total / v->count, histogram_percentile(v, 0.99),
+                       profile_ticks_to_ns(histogram_percentile(r, 0.99)));
+            } else {
+                printf("| %-12s | %-11.0f | %-11.0f | %-12.0f | %-11s | %-11s | %-12s | %-11s | %-11.0f |\n",
+                       algorithm_name(alg),
+                       profile_ticks_to_ns(histogram_percentile(a, 0.5)),
+                       profile_ticks_to_ns(histogram_percentile(a, 0.99)), profile_ticks_to_ns(a->max),
+                       "-", "-", "-", "-",
+                       profile_ticks_to_ns(histogram_percentile(r, 0.99)));
+            }
+        }
+        printf("-----------------------------------------------------------------------------------------------------------------------------\n");
+        free_workload(&w);
+    }
+    
+    total_memory_size = saved_memory_size;
+    profile_reset();
+    clear_memory_list();
+}
+#endif
+
+/**
+ * 计算分区链表、伙伴系统块链表、位图和TLSF块链表的校验值（FNV-1a），用进程名而不是进程号参与计算，
+ * 进程号重新编号后校验值不变
+ */
+unsigned long long memory_checksum() {
+    unsigned long long hash = 14695981039346656037ULL;
+    
+    for (Partition *p = memory_list; p; p = p->next) {
+        long long fields[3] = {p->start_addr, p->size, p->status};
+        const unsigned char *bytes = (const unsigned char *)fields;
+        const char *name = process_name_of(p->process_id);
+        
+        for (size_t k = 0; k < sizeof(fields); k++) {
+            hash = (hash ^ bytes[k]) * 1099511628211ULL;
+        }
+        for (; *name; name++) {
+            hash = (hash ^ (unsigned char)*name) * 1099511628211ULL;
+        }
+    }
+    for (BuddyBlock *b = buddy_list; b; b = b->next) {
+        long long fields[4] = {b->start_addr, b->order, b->status, b->request_size};
+        const unsigned char *bytes = (const unsigned char *)fields;
+        
+        for (size_t k = 0; k < sizeof(fields); k++) {
+            hash = (hash ^ bytes[k]) * 1099511628211ULL;
+        }
+    }
+    for (long long w = 0; w < bitmap_words; w++) {
+        const unsigned char *bytes = (const unsigned char *)&bitmap_free_bits[w];
+        
+        for (size_t k = 0; k < sizeof(bitmap_free_bits[w]); k++) {
+            hash = (hash ^ bytes[k]) * 1099511628211ULL;
+        }
+    }
+    for (TlsfBlock *b = tlsf_list; b; b = b->next) {
+        long long fields[3] = {b->start_addr, b->size, b->status};
+        const unsigned char *bytes = (const unsigned char *)fields;
+        
+        for (size_t k = 0; k < sizeof(fields); k++) {
+            hash = (hash ^ bytes[k]) * 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+/**
+ * 测试快照的保存和恢复：用负载把64GB内存预热成约百万个分区的碎片化状态，
+ * 比较预热耗时与保存、恢复快照的耗时；再让原状态和恢复的状态继续执行同一段负载，
+ * 检查两者的分配失败次数和最终内存布局完全一致
+ */
+void benchmark_snapshot() {
+    const char *path = "benchmark.snapshot";  // 测试用的快照文件，结束时删除
+    int warmup = 1500000;       // 预热的分配次数
+    int rest = 200000;          // 保存快照后继续执行的分配次数
+    int mean_lifetime = 600000; // 进程平均存活的分配次数，预热后内存中约有百万个分区
+    int policies[] = {BEST_FIT, BUDDY_SYSTEM, BITMAP_SYSTEM, TLSF_SYSTEM};  // 各分配引擎都参与，快照同时包含全部引擎
+    long long partitions = 0;
+    long long file_size;
+    double start, warmup_ms, save_ms, load_ms;
+    unsigned long long expected, actual;
+    int expected_failures = 0, actual_failures = 0;
+    MemoryMetrics before, after;
+    FILE *fp;
+    Workload w;
+    
+    total_memory_size = 64LL * 1024 * 1024;  // 64GB
+    generate_workload(&w, DIST_EXPONENTIAL, warmup + rest, mean_lifetime,
+                      total_memory_size * 7 / 10 / mean_lifetime);
+    
+    // 预热：可变分区用最佳适应，伙伴系统、位图分配和TLSF用同一份负载，各引擎的状态都写入快照
+    start = get_time_seconds();
+    build_memory_segments(2);
+    for (int i = 0; i < (int)(sizeof(policies) / sizeof(policies[0])); i++) {
+        algorithm = policies[i];
+        run_workload_range(&w, 0, warmup);
+    }
+    warmup_ms = (get_time_seconds() - start) * 1000;
+    for (Partition *p = memory_list; p; p = p->next) {
+        partitions++;
+    }
+    
+    start = get_time_seconds();
+    if (!save_snapshot(path)) {
+        free_workload(&w);
+        clear_memory_list();
+        return;
+    }
+    save_ms = (get_time_seconds() - start) * 1000;
+    fp = fopen(path, "rb");
+    fseek(fp, 0, SEEK_END);
+    file_size = ftell(fp);
+    fclose(fp);
+    
+    // 原状态继续执行，记录结果
+    algorithm = BEST_FIT;
+    query_metrics(&before);
+    for (int i = 0; i < (int)(sizeof(policies) / sizeof(policies[0])); i++) {
+        algorithm = policies[i];
+        expected_failures += run_workload_range(&w, warmup, warmup + rest);
+    }
+    expected = memory_checksum();
+    
+    start = get_time_seconds();
+    if (!load_snapshot(path)) {
+        free_workload(&w);
+        clear_memory_list();
+        remove(path);
+        return;
+    }
+    load_ms = (get_time_seconds() - start) * 1000;
+    
+    // 恢复的状态执行同一段负载
+    algorithm = BEST_FIT;
+    query_metrics(&after);
+    for (int i = 0; i < (int)(sizeof(policies) / sizeof(policies[0])); i++) {
+        algorithm = policies[i];
+        actual_failures += run_workload_range(&w, warmup, warmup + rest);
+    }
+    actual = memory_checksum();
+    
+    printf("\n快照保存/恢复测试（总内存%lldKB，预热%d次分配）\n", total_memory_size, warmup);
+    printf("--------------------------------------------------------------\n");
+    printf("分区数: %lld  空闲分区数: %lld  进程数: %d\n", partitions, before.hole_count, process_count);
+    printf("预热耗时: %.1fms\n", warmup_ms);
+    printf("保存快照: %.1fms  文件大小: %.1fMB\n", save_ms, file_size / 1048576.0);
+    printf("恢复快照: %.1fms（预热耗时的%.2f%%）\n", load_ms, 100 * load_ms / warmup_ms);
+    printf("恢复后的占用指标: %s\n",
+           before.free_total == after.free_total && before.hole_count == after.hole_count &&
+           before.largest_free == after.largest_free ? "一致" : "不一致");
+    printf("继续执行%d次分配: 失败 %d / %d，内存布局%s\n", rest, actual_failures, expected_failures,
+           actual_failures == expected_failures && actual == expected ? "一致" : "不一致");
+    printf("--------------------------------------------------------------\n");
+    
+    free_workload(&w);
+    clear_memory_list();
+    remove(path);
+}
+
+/**
+ * 标量内核：第一个不小于x的元素的下标
+ */
+int first_ge_scalar(const long long *a, int n, long long x) {
+    for (int i = 0; i < n; i++) {
+        if (a[i] >= x) {
+            return i;
+        }
     }
+    return -1;
+}
+
+/**
+ * 标量内核：不小于x的元素中的最小值，没有返回0
+ */
+long long min_ge_scalar(const long long *a, int n, long long x) {
+    long long best = LLONG_MAX;
     
-    // 打印菜单内容
-    printf("\n======= 动态分区存储管理模拟 =======\n");
-    printf("当前分配算法: %s\n", alg_name);
-    printf("1. 显示内存使用情况\n");
-    printf("2. 分配内存\n");
-    printf("3. 释放内存\n");
-    printf("4. 切换分配算法\n");
-    printf("5. 重置内存\n");
-    printf("6. 退出程序\n");
-    printf("===================================\n");
+    for (int i = 0; i < n; i++) {
+        if (a[i] >= x && a[i] < best) {
+            best = a[i];
+        }
+    }
+    return best == LLONG_MAX ? 0 : best;
 }
 
 /**
- * 清屏函数
+ * 标量内核：最大值
  */
-void clear_screen() {
-    system("cls");  // Windows系统使用cls命令清屏
+long long max_scalar(const long long *a, int n) {
+    long long best = 0;
+    
+    for (int i = 0; i < n; i++) {
+        if (a[i] > best) {
+            best = a[i];
+        }
+    }
+    return best;
 }
 
+#ifdef FIT_SIMD_X86
 /**
- * 设置文本颜色
- * @param color 颜色代码
+ * SSE2没有64位整数比较指令，用32位比较拼出a > b：
+ * 高32位有符号比较为大，或高32位相等且低32位无符号比较为大
  */
-void set_text_color(int color) {                        //接受一个 int color 参数，表示要设置的文本颜色       
-    HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);  // 获取控制台句柄
-    SetConsoleTextAttribute(hConsole, color);           // 设置文本颜色属性
-    //调用 SetConsoleTextAttribute 函数来设置控制台文本的颜色。hConsole 是获取的控制台句柄，color 是传入的颜色代码
-} 
+__attribute__((target("sse2")))
+static inline __m128i cmpgt_epi64_sse2(__m128i a, __m128i b) {
+    __m128i bias = _mm_set1_epi32((int)0x80000000);  // 低32位异或符号位后可用有符号比较
+    __m128i gt = _mm_cmpgt_epi32(a, b);
+    __m128i eq = _mm_cmpeq_epi32(a, b);
+    __m128i gt_low = _mm_cmpgt_epi32(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias));
+    
+    // 把每个64位元素高半部分/低半部分的比较结果复制到整个元素
+    gt = _mm_shuffle_epi32(gt, _MM_SHUFFLE(3, 3, 1, 1));
+    eq = _mm_shuffle_epi32(eq, _MM_SHUFFLE(3, 3, 1, 1));
+    gt_low = _mm_shuffle_epi32(gt_low, _MM_SHUFFLE(2, 2, 0, 0));
+    return _mm_or_si128(gt, _mm_and_si128(eq, gt_low));
+}
 
 /**
- * 重置文本颜色为默认值
+ * 按掩码选择：mask为全1的元素取a，否则取b
  */
-void reset_text_color() {
-    HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);  // 获取控制台句柄，为之后的 SetConsoleTextAttribute 函数提供控制台句柄
-    SetConsoleTextAttribute(hConsole, 7);               // 设置为默认的白色(7)
-} 
\ No newline at end of file
+__attribute__((target("sse2")))
+static inline __m128i select_sse2(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+/**
+ * SSE2内核：每次循环比较4个元素（两条2路比较）
+ */
+__attribute__((target("sse2")))
+int first_ge_sse2(const long long *a, int n, long long x) {
+    __m128i t = _mm_set1_epi64x(x - 1);  // a >= x 等价于 a > x-1
+    int i = 0;
+    
+    for (; i + 4 <= n; i += 4) {
+        __m128i lo = cmpgt_epi64_sse2(_mm_loadu_si128((const __m128i *)(a + i)), t);
+        __m128i hi = cmpgt_epi64_sse2(_mm_loadu_si128((const __m128i *)(a + i + 2)), t);
+        int mask = _mm_movemask_pd(_mm_castsi128_pd(lo)) |
+                   (_mm_movemask_pd(_mm_castsi128_pd(hi)) << 2);
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    for (; i < n; i++) {
+        if (a[i] >= x) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * SSE2内核：不小于x的元素中的最小值
+ */
+__attribute__((target("sse2")))
+long long min_ge_sse2(const long long *a, int n, long long x) {
+    __m128i t = _mm_set1_epi64x(x - 1);
+    __m128i inf = _mm_set1_epi64x(LLONG_MAX);
+    __m128i best = inf;
+    long long lanes[2], result = LLONG_MAX;
+    int i = 0;
+    
+    for (; i + 2 <= n; i += 2) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i c = select_sse2(cmpgt_epi64_sse2(v, t), v, inf);  // 不满足的位置换成最大值
+        best = select_sse2(cmpgt_epi64_sse2(best, c), c, best);
+    }
+    _mm_storeu_si128((__m128i *)lanes, best);
+    for (int k = 0; k < 2; k++) {
+        if (lanes[k] < result) {
+            result = lanes[k];
+        }
+    }
+    for (; i < n; i++) {
+        if (a[i] >= x && a[i] < result) {
+            result = a[i];
+        }
+    }
+    return result == LLONG_MAX ? 0 : result;
+}
+
+/**
+ * SSE2内核：最大值
+ */
+__attribute__((target("sse2")))
+long long max_sse2(const long long *a, int n) {
+    __m128i best = _mm_setzero_si128();
+    long long lanes[2], result = 0;
+    int i = 0;
+    
+    for (; i + 2 <= n; i += 2) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(a + i));
+        best = select_sse2(cmpgt_epi64_sse2(v, best), v, best);
+    }
+    _mm_storeu_si128((__m128i *)lanes, best);
+    for (int k = 0; k < 2; k++) {
+        if (lanes[k] > result) {
+            result = lanes[k];
+        }
+    }
+    for (; i < n; i++) {
+        if (a[i] > result) {
+            result = a[i];
+        }
+    }
+    return result;
+}
+
+/**
+ * AVX2内核：每次循环比较8个元素（两条4路64位比较指令）
+ */
+__attribute__((target("avx2")))
+int first_ge_avx2(const long long *a, int n, long long x) {
+    __m256i t = _mm256_set1_epi64x(x - 1);
+    int i = 0;
+    
+    for (; i + 8 <= n; i += 8) {
+        __m256i lo = _mm256_cmpgt_epi64(_mm256_loadu_si256((const __m256i *)(a + i)), t);
+        __m256i hi = _mm256_cmpgt_epi64(_mm256_loadu_si256((const __m256i *)(a + i + 4)), t);
+        int mask = _mm256_movemask_pd(_mm256_castsi256_pd(lo)) |
+                   (_mm256_movemask_pd(_mm256_castsi256_pd(hi)) << 4);
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    for (; i < n; i++) {
+        if (a[i] >= x) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * AVX2内核：不小于x的元素中的最小值（AVX2没有64位min指令，用比较和混合代替）
+ */
+__attribute__((target("avx2")))
+long long min_ge_avx2(const long long *a, int n, long long x) {
+    __m256i t = _mm256_set1_epi64x(x - 1);
+    __m256i inf = _mm256_set1_epi64x(LLONG_MAX);
+    __m256i best = inf;
+    long long lanes[4], result = LLONG_MAX;
+    int i = 0;
+    
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i c = _mm256_blendv_epi8(inf, v, _mm256_cmpgt_epi64(v, t));  // 不满足的位置换成最大值
+        best = _mm256_blendv_epi8(best, c, _mm256_cmpgt_epi64(best, c));
+    }
+    _mm256_storeu_si256((__m256i *)lanes, best);
+    for (int k = 0; k < 4; k++) {
+        if (lanes[k] < result) {
+            result = lanes[k];
+        }
+    }
+    for (; i < n; i++) {
+        if (a[i] >= x && a[i] < result) {
+            result = a[i];
+        }
+    }
+    return result == LLONG_MAX ? 0 : result;
+}
+
+/**
+ * AVX2内核：最大值
+ */
+__attribute__((target("avx2")))
+long long max_avx2(const long long *a, int n) {
+    __m256i best = _mm256_setzero_si256();
+    long long lanes[4], result = 0;
+    int i = 0;
+    
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(a + i));
+        best = _mm256_blendv_epi8(best, v, _mm256_cmpgt_epi64(v, best));
+    }
+    _mm256_storeu_si256((__m256i *)lanes, best);
+    for (int k = 0; k < 4; k++) {
+        if (lanes[k] > result) {
+            result = lanes[k];
+        }
+    }
+    for (; i < n; i++) {
+        if (a[i] > result) {
+            result = a[i];
+        }
+    }
+    return result;
+}
+#endif
+
+/**
+ * 列出当前CPU可用的全部查找内核，按指令集从低到高排列
+ * @param kernels 输出数组，至少3个元素
+ * @return 可用内核数
+ */
+int available_fit_kernels(FitKernels *kernels) {
+    int count = 0;
+    
+    kernels[count].name = "标量";
+    kernels[count].first_ge = first_ge_scalar;
+    kernels[count].min_ge = min_ge_scalar;
+    kernels[count].max = max_scalar;
+    count++;
+    
+#ifdef FIT_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        kernels[count].name = "SSE2";
+        kernels[count].first_ge = first_ge_sse2;
+        kernels[count].min_ge = min_ge_sse2;
+        kernels[count].max = max_sse2;
+        count++;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        kernels[count].name = "AVX2";
+        kernels[count].first_ge = first_ge_avx2;
+        kernels[count].min_ge = min_ge_avx2;
+        kernels[count].max = max_avx2;
+        count++;
+    }
+#endif
+    
+    return count;
+}
+
+/**
+ * 按CPU支持的指令集选择查找内核：支持AVX2时使用AVX2，否则直接使用标量实现。
+ * SSE2没有64位比较，拼出的比较在--bench-simd中各长度下都比标量慢，只保留用于对比
+ */
+void select_fit_kernels() {
+    FitKernels kernels[3];
+    int count = available_fit_kernels(kernels);
+    
+    fit_kernels = kernels[0];
+    for (int i = 1; i < count; i++) {
+        if (strcmp(kernels[i].name, "AVX2") == 0) {
+            fit_kernels = kernels[i];
+        }
+    }
+}
+
+/**
+ * 在数组分区表中after之后插入一个空块（after为NULL时插入到表头）
+ * @return 新块指针
+ */
+TableChunk* table_new_chunk(TableChunk *after) {
+    TableChunk *c = (TableChunk *)malloc(sizeof(TableChunk));
+    
+    if (!c) {
+        printf("内存分配失败！\n");
+        exit(1);
+    }
+    c->count = 0;
+    if (after) {
+        c->next = after->next;
+        after->next = c;
+    } else {
+        c->next = partition_table;
+        partition_table = c;
+    }
+    return c;
+}
+
+/**
+ * 释放数组分区表
+ */
+void table_clear() {
+    TableChunk *c = partition_table, *next;
+    
+    while (c) {
+        next = c->next;
+        free(c);
+        c = next;
+    }
+    partition_table = NULL;
+}
+
+/**
+ * 按当前分区链表创建数组分区表，两者的内存布局相同
+ */
+void table_build() {
+    TableChunk *c;
+    
+    table_clear();
+    front_cache_flush();  // 数组分区表只区分空闲和已分配
+    lazy_coalesce_sweep();  // 数组分区表释放时立即合并，建立前先合并
+    if (!fit_kernels.first_ge) {
+        select_fit_kernels();
+    }
+    c = table_new_chunk(NULL);
+    for (Partition *p = memory_list; p; p = p->next) {
+        if (c->count == TABLE_CHUNK_CAPACITY) {
+            c = table_new_chunk(c);
+        }
+        c->start_addr[c->count] = p->start_addr;
+        c->size[c->count] = p->size;
+        c->status[c->count] = (unsigned char)p->status;
+        c->free_size[c->count] = p->status == FREE ? p->size : 0;
+        c->process_id[c->count] = p->process_id;
+        c->count++;
+    }
+}
+
+/**
+ * 在块c的位置i插入一个空闲分区，块满时先对半分裂
+ * @param c 块
+ * @param i 插入位置（0 ~ c->count）
+ */
+void table_insert_free(TableChunk *c, int i, long long start_addr, long long size) {
+    if (c->count == TABLE_CHUNK_CAPACITY) {
+        TableChunk *right = table_new_chunk(c);  // 后一半移到新块
+        int half = c->count / 2;
+        
+        right->count = c->count - half;
+        memcpy(right->start_addr, c->start_addr + half, sizeof(long long) * right->count);
+        memcpy(right->size, c->size + half, sizeof(long long) * right->count);
+        memcpy(right->status, c->status + half, right->count);
+        memcpy(right->free_size, c->free_size + half, sizeof(long long) * right->count);
+        memcpy(right->process_id, c->process_id + half, sizeof(unsigned int) * right->count);
+        c->count = half;
+        
+        if (i > half) {
+            c = right;
+            i -= half;
+        }
+    }
+    
+    // 后面的元素依次后移一位
+    memmove(c->start_addr + i + 1, c->start_addr + i, sizeof(long long) * (c->count - i));
+    memmove(c->size + i + 1, c->size + i, sizeof(long long) * (c->count - i));
+    memmove(c->status + i + 1, c->status + i, c->count - i);
+    memmove(c->free_size + i + 1, c->free_size + i, sizeof(long long) * (c->count - i));
+    memmove(c->process_id + i + 1, c->process_id + i, sizeof(unsigned int) * (c->count - i));
+    c->start_addr[i] = start_addr;
+    c->size[i] = size;
+    c->status[i] = FREE;
+    c->free_size[i] = size;
+    c->process_id[i] = FREE_PROCESS_ID;
+    c->count++;
+}
+
+/**
+ * 删除块c中位置i的分区，后面的元素依次前移一位
+ * 注意：块变空时由调用者把它从表中删除
+ */
+void table_erase(TableChunk *c, int i) {
+    c->count--;
+    memmove(c->start_addr + i, c->start_addr + i + 1, sizeof(long long) * (c->count - i));
+    memmove(c->size + i, c->size + i + 1, sizeof(long long) * (c->count - i));
+    memmove(c->status + i, c->status + i + 1, c->count - i);
+    memmove(c->free_size + i, c->free_size + i + 1, sizeof(long long) * (c->count - i));
+    memmove(c->process_id + i, c->process_id + i + 1, sizeof(unsigned int) * (c->count - i));
+}
+
+/**
+ * 按当前算法在数组分区表中查找合适的空闲分区，用查找内核逐块处理打包的空闲大小数组
+ * 最先适应取地址最低者；最佳/最坏适应取最小/最大者，大小相同时取地址最低者，
+ * 与链表上的查找结果一致。循环首次适应和伙伴系统按最先适应处理
+ * @param size 请求的内存大小
+ * @param chunk 输出找到的分区所在的块
+ * @return 分区在块中的位置，没找到返回-1
+ */
+int table_find(long long size, TableChunk **chunk) {
+    long long best = 0;  // 最佳/最坏适应目前找到的分区大小
+    
+    *chunk = NULL;
+    for (TableChunk *c = partition_table; c; c = c->next) {
+        if (algorithm == BEST_FIT) {
+            long long v = fit_kernels.min_ge(c->free_size, c->count, size);
+            if (v && (!best || v < best)) {
+                best = v;
+                *chunk = c;
+            }
+        } else if (algorithm == WORST_FIT) {
+            long long v = fit_kernels.max(c->free_size, c->count);
+            if (v >= size && v > best) {
+                best = v;
+                *chunk = c;
+            }
+        } else {
+            int i = fit_kernels.first_ge(c->free_size, c->count, size);
+            if (i >= 0) {
+                *chunk = c;
+                return i;  // 最先适应：第一个满足的就是地址最低的
+            }
+        }
+    }
+    if (!*chunk) {
+        return -1;
+    }
+    
+    // 在选中的块中找到该大小第一次出现的位置：最坏适应时best是块内最大值，
+    // 不小于它的第一个元素即是；最佳适应时块内可能还有更大的空闲分区，需要逐个比较
+    if (algorithm == BEST_FIT) {
+        for (int i = 0; i < (*chunk)->count; i++) {
+            if ((*chunk)->free_size[i] == best) {
+                return i;
+            }
+        }
+    }
+    return fit_kernels.first_ge((*chunk)->free_size, (*chunk)->count, best);
+}
+
+/**
+ * 在数组分区表中分配内存，剩余部分作为新的空闲分区插入到其后
+ * @param req 资源请求结构体
+ * @return 分配结果：1-成功，0-失败
+ */
+int table_allocate(Request req) {
+    TableChunk *c;
+    ProcessEntry *e;
+    int i = table_find(req.size, &c);
+    
+    if (i < 0) {
+        return 0;
+    }
+    
+    if (c->size[i] > req.size) {
+        table_insert_free(c, i + 1, c->start_addr[i] + req.size, c->size[i] - req.size);
+        if (i >= c->count) {  // 块被分裂后，原分区位于后一块
+            i -= c->count;
+            c = c->next;
+        }
+        c->size[i] = req.size;
+    }
+    c->status[i] = BUSY;
+    c->free_size[i] = 0;
+    e = process_lookup(req.process_name, 1);
+    c->process_id[i] = e->process_id;
+    e->table_partitions++;
+    return 1;
+}
+
+/**
+ * 在数组分区表中释放进程的全部内存：顺序扫描进程号数组找到该进程的分区，
+ * 标为空闲后与地址相邻的前后空闲分区合并，被合并的元素从块中删除，空块从表中删除；
+ * 进程的分区都已找到时提前结束扫描
+ * @param process_name 要释放内存的进程名
+ * @return 释放结果：1-成功，0-失败（未找到进程）
+ */
+int table_release(const char *process_name) {
+    ProcessEntry *e = process_lookup(process_name, 0);
+    TableChunk *prev_chunk = NULL;  // c的前一块
+    TableChunk *c = partition_table;
+    
+    if (!e || e->table_partitions == 0) {
+        return 0;  // 该进程在数组分区表中没有分区
+    }
+    
+    // 该进程的分区全部释放后即可停止扫描
+    while (c && e->table_partitions > 0) {
+        int r = 0;
+        
+        while (r < c->count && e->table_partitions > 0) {
+            TableChunk *nc = c, *pc = c;  // 后一个和前一个分区所在的块
+            int ni = r + 1, pi = r - 1;   // 后一个和前一个分区在块中的位置
+            
+            if (c->process_id[r] != e->process_id) {
+                r++;
+                continue;
+            }
+            c->status[r] = FREE;
+            c->free_size[r] = c->size[r];
+            c->process_id[r] = FREE_PROCESS_ID;
+            e->table_partitions--;
+            
+            // 与后一个空闲分区合并
+            if (ni == c->count) {
+                nc = c->next;
+                ni = 0;
+            }
+            if (nc && nc->status[ni] == FREE && c->start_addr[r] + c->size[r] == nc->start_addr[ni]) {
+                c->size[r] += nc->size[ni];
+                c->free_size[r] = c->size[r];
+                table_erase(nc, ni);
+                if (nc->count == 0) {  // 只可能是后一块
+                    c->next = nc->next;
+                    free(nc);
+                }
+            }
+            
+            // 与前一个空闲分区合并，当前分区被删除，下一个分区移到位置r
+            if (pi < 0) {
+                pc = prev_chunk;
+                pi = pc ? pc->count - 1 : -1;
+            }
+            if (pc && pc->status[pi] == FREE && pc->start_addr[pi] + pc->size[pi] == c->start_addr[r]) {
+                pc->size[pi] += c->size[r];
+                pc->free_size[pi] = pc->size[pi];
+                table_erase(c, r);
+                if (c->count == 0) {  // 此时pc一定是前一块
+                    prev_chunk->next = c->next;
+                    free(c);
+                    c = prev_chunk;
+                    break;
+                }
+                continue;
+            }
+            r++;
+        }
+        
+        prev_chunk = c;
+        c = c->next;
+    }
+    process_remove_if_empty(e);
+    return 1;
+}
+
+/**
+ * 比较数组分区表与链表两种存储方式：
+ * 1. 在大量空闲分区的碎片化布局上测试首次适应的查找延迟：只有地址最高的一个空闲分区放得下请求，
+ *    链表遍历和数组分区表每次都扫描全部分区，各规模下的工作量都确定，与平衡树查找比较
+ * 2. 用同一份负载比较首次/最佳/最坏适应在两种存储方式上的分配吞吐量，两者的失败次数应相同
+ */
+void benchmark_table() {
+    int sizes[] = {1000, 10000, 100000, 1000000};  // 空闲分区数量
+    int policies[] = {FIRST_FIT, BEST_FIT, WORST_FIT};
+    int ops = 100000;           // 吞吐量测试的分配次数
+    int mean_lifetime = 4096;   // 进程平均存活的分配次数，使内存中有数千个分区
+    volatile int sink = 0;      // 防止查找结果被编译器优化掉
+    Workload w;
+    
+    printf("\n首次适应查找延迟（请求大小1000~1024KB，只有地址最高的一个空闲分区放得下，需要扫描全部分区）\n");
+    printf("--------------------------------------------------------------------------\n");
+    printf("| 空闲分区数 | 链表遍历(ns/次) | 空闲分区平衡树(ns/次) | 数组分区表(ns/次) |\n");
+    printf("--------------------------------------------------------------------------\n");
+    for (int i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++) {
+        int lookups = 20000000 / sizes[i];  // 规模越大查找次数越少，控制总时间
+        int *requests = (int *)malloc(sizeof(int) * lookups);
+        double start, list_ns, index_ns, table_ns;
+        TableChunk *c;
+        
+        if (!requests) {
+            printf("内存分配失败！\n");
+            return;
+        }
+        srand(1);
+        build_fragmented_memory(sizes[i], 1);
+        table_build();
+        for (int j = 0; j < lookups; j++) {
+            requests[j] = 1000 + rand() % 25;
+        }
+        algorithm = FIRST_FIT;
+        
+        // 原始的按地址顺序遍历整个分区链表
+        start = get_time_seconds();
+        for (int j = 0; j < lookups; j++) {
+            for (Partition *p = memory_list; p; p = p->next) {
+                if (p->status == FREE && p->size >= requests[j]) {
+                    sink += (int)p->start_addr;
+                    break;
+                }
+            }
+        }
+        list_ns = (get_time_seconds() - start) * 1e9 / lookups;
+        
+        start = get_time_seconds();
+        for (int j = 0; j < lookups; j++) {
+            Partition *p = first_fit(requests[j]);
+            sink += p ? (int)p->start_addr : 0;
+        }
+        index_ns = (get_time_seconds() - start) * 1e9 / lookups;
+        
+        start = get_time_seconds();
+        for (int j = 0; j < lookups; j++) {
+            sink += table_find(requests[j], &c);
+        }
+        table_ns = (get_time_seconds() - start) * 1e9 / lookups;
+        
+        printf("| %-10d | %-15.1f | %-21.1f | %-17.1f |\n", sizes[i], list_ns, index_ns, table_ns);
+        free(requests);
+    }
+    printf("--------------------------------------------------------------------------\n");
+    (void)sink;
+    
+    // 吞吐量测试：总内存64MB，每个算法在两种存储方式上执行完全相同的操作序列
+    total_memory_size = 64 * 1024;
+    generate_workload(&w, DIST_UNIFORM, ops, mean_lifetime, (long long)(total_memory_size * 0.7 / mean_lifetime));
+    
+    printf("\n分配吞吐量（均匀分布负载，%d次分配，平均存活%d次分配，总内存%lldKB）\n",
+           ops, mean_lifetime, total_memory_size);
+    printf("---------------------------------------------------------------------------\n");
+    printf("| 算法     | 链表(操作/秒) | 链表失败 | 数组分区表(操作/秒) | 数组分区表失败 |\n");
+    printf("---------------------------------------------------------------------------\n");
+    for (int i = 0; i < (int)(sizeof(policies) / sizeof(policies[0])); i++) {
+        int list_failures = 0, table_failures = 0;
+        double start, list_rate, table_rate;
+        
+        build_memory_segments(2);
+        table_build();  // 两种存储方式从相同的初始布局开始
+        algorithm = policies[i];
+        
+        start = get_time_seconds();
+        for (int t = 0; t < ops; t++) {
+            if (!allocate_memory(w.allocs[t], 1)) {
+                list_failures++;
+            }
+            for (int r = w.release_head[t]; r != -1; r = w.release_next[r]) {
+                release_memory(w.allocs[r].process_name);
+            }
+        }
+        list_rate = 2.0 * ops / (get_time_seconds() - start);
+        
+        start = get_time_seconds();
+        for (int t = 0; t < ops; t++) {
+            if (!table_allocate(w.allocs[t])) {
+                table_failures++;
+            }
+            for (int r = w.release_head[t]; r != -1; r = w.release_next[r]) {
+                table_release(w.allocs[r].process_name);
+            }
+        }
+        table_rate = 2.0 * ops / (get_time_seconds() - start);
+        
+        printf("| %-8s | %-13.0f | %-8d | %-19.0f | %-14d |\n",
+               algorithm_name(policies[i]), list_rate, list_failures, table_rate, table_failures);
+    }
+    printf("---------------------------------------------------------------------------\n");
+    
+    free_workload(&w);
+    table_clear();
+    clear_memory_list();
+}
+
+/**
+ * 测试各指令集查找内核的速度：在打包的空闲大小数组上（一半位置为0，表示已分配）
+ * 分别执行“第一个不小于x”“不小于x的最小值”“最大值”三种操作，
+ * 请求大小大于所有元素，使每次都扫描整个数组，输出平均每个元素的耗时
+ */
+void benchmark_simd() {
+    int lengths[] = {256, 4096, 65536, 1048576};  // 数组长度，256即数组分区表一块的容量
+    FitKernels kernels[3];
+    int kernel_count = available_fit_kernels(kernels);
+    volatile int sink = 0;  // 防止结果被编译器优化掉
+    
+    printf("\n查找内核测试（ns/元素，越小越好）\n");
+    printf("----------------------------------------------------------\n");
+    printf("| 数组长度 | 内核 | 第一个>=x  | >=x的最小值 | 最大值     |\n");
+    printf("----------------------------------------------------------\n");
+    
+    for (int i = 0; i < (int)(sizeof(lengths) / sizeof(lengths[0])); i++) {
+        int n = lengths[i];
+        int repeats = 64 * 1048576 / n;  // 每种操作共处理约6400万个元素
+        long long *a = (long long *)malloc(sizeof(long long) * n);
+        long long expected[3];
+        
+        if (!a) {
+            printf("内存分配失败！\n");
+            return;
+        }
+        srand(1);
+        // 大小的高32位和低32位都取随机值，使64位比较的两半都起作用
+        for (int j = 0; j < n; j++) {
+            a[j] = rand() % 2 ? ((long long)(rand() % 1024) << 32) + 1 + rand() % 1024 : 0;
+        }
+        
+        for (int k = 0; k < kernel_count; k++) {
+            double start, first_ns, min_ns, max_ns;
+            long long results[3];
+            
+            start = get_time_seconds();
+            for (int r = 0; r < repeats; r++) {
+                sink += kernels[k].first_ge(a, n, 1024LL << 32);
+            }
+            first_ns = (get_time_seconds() - start) * 1e9 / ((double)repeats * n);
+            
+            start = get_time_seconds();
+            for (int r = 0; r < repeats; r++) {
+                sink += (int)kernels[k].min_ge(a, n, (512LL + (r & 255)) << 32);
+            }
+            min_ns = (get_time_seconds() - start) * 1e9 / ((double)repeats * n);
+            
+            start = get_time_seconds();
+            for (int r = 0; r < repeats; r++) {
+                sink += (int)kernels[k].max(a, n);
+            }
+            max_ns = (get_time_seconds() - start) * 1e9 / ((double)repeats * n);
+            
+            // 各内核的结果必须与标量实现一致
+            results[0] = kernels[k].first_ge(a, n, (1000LL << 32) + 512);
+            results[1] = kernels[k].min_ge(a, n, (700LL << 32) + 512);
+            results[2] = kernels[k].max(a, n);
+            if (k == 0) {
+                memcpy(expected, results, sizeof(expected));
+            } else if (memcmp(expected, results, sizeof(expected)) != 0) {
+                printf("%s内核的结果与标量实现不一致！\n", kernels[k].name);
+            }
+            
+            printf("| %-8d | %-4s | %-10.3f | %-11.3f | %-10.3f |\n",
+                   n, kernels[k].name, first_ns, min_ns, max_ns);
+        }
+        free(a);
+    }
+    printf("----------------------------------------------------------\n");
+    (void)sink;
+}
@@ -31,11 +31,16 @@
 #define BLOCKS_PER_JOB 4           // 每个作业分配的内存块数
 #define MAX_JOBS 1                 // 最大作业数
 
+// 二进制轨迹文件格式，与dynamic_memory_management.c的--generate生成的文件相同
+#define TRACE_MAGIC "DMMTRCE"      // 文件标识（含结尾的'\0'共8字节）
+#define TRACE_VERSION 1            // 文件格式版本
+#define TRACE_ACCESS 3             // 页面访问记录（分配和释放记录由动态分区程序回放）
+
 // 页表项结构 - 每个页面在页表中的一个条目
 typedef struct {
     int page_number;      // 页号 - 标识逻辑页面
     int present;          // 存在标志 - 1表示在内存中，0表示不在
-    int frame_number;     // 内存块号 - 页面所在的物理内存块
+    long long frame_number;  // 内存块号 - 页面所在的物理内存块（64位，可模拟TB级物理内存）
     int modified;         // 修改标志 - 1表示被修改过，0表示未修改
     int disk_location;    // 磁盘位置 - 页面在磁盘上的位置
     int load_time;        // 页面装入时间（用于FIFO算法）- 记录页面被装入的时间点
@@ -48,32 +53,71 @@ typedef struct {
     int offset;           // 页内地址 - 页内偏移量
 } Instruction;
 
+// 二进制轨迹文件头
+typedef struct {
+    char magic[8];                // 文件标识
+    long long version;            // 文件格式版本
+    long long record_count;       // 记录数
+    long long process_count;      // 进程数
+    long long page_count;         // 访问记录的页号范围
+    long long page_size;          // 页面大小（字节）
+} TraceHeader;
+
+// 二进制轨迹记录（24字节）
+typedef struct {
+    double time;                  // 事件时间（秒）
+    unsigned int process_id;      // 进程号
+    char type;                    // 记录类型
+    char operation;               // 页面访问的操作类型，与指令相同
+    unsigned short reserved;      // 保留，对齐用
+    union {
+        long long size;           // 分配大小(KB)
+        struct {
+            int page_number;      // 访问的页号
+            int offset;           // 页内地址
+        } access;
+    } data;
+} TraceRecord;
+
 // 全局变量
 PageTableEntry page_table[MAX_PAGES];  // 页表 - 记录所有页面的状态信息
-int memory_blocks[BLOCKS_PER_JOB];     // 作业分配的内存块 - 记录分配给作业的物理内存块
+long long memory_blocks[BLOCKS_PER_JOB];  // 作业分配的内存块 - 记录分配给作业的物理内存块
 int current_time = 0;                  // 当前时间（用于FIFO算法）- 时间计数器
 int next_free_block = 0;               // 下一个空闲内存块 - 跟踪可用的内存块
+int quiet = 0;                         // 回放轨迹时不打印每次换页的信息
+long long write_backs = 0;             // 写回磁盘的页面数
 
 // 函数声明
 void initialize_page_table();          // 初始化页表
 void initialize_memory_blocks();       // 初始化内存块
 void display_page_table();             // 显示页表状态
-void display_instruction_info(int seq, Instruction inst, int physical_addr, int page_fault, int victim_page);  // 显示指令执行信息
-int get_physical_address(Instruction inst);  // 获取物理地址
+void display_instruction_info(int seq, Instruction inst, long long physical_addr, int page_fault, int victim_page);  // 显示指令执行信息
+long long get_physical_address(Instruction inst);  // 获取物理地址
 int handle_page_fault(int page_number);      // 处理缺页中断
 int find_victim_page();                      // 查找要被置换的页面
 void save_page_to_disk(int page_number);     // 保存页面到磁盘
-void load_page_from_disk(int page_number, int frame_number);  // 从磁盘加载页面
+void load_page_from_disk(int page_number, long long frame_number);  // 从磁盘加载页面
 void set_text_color(int color);              // 设置文本颜色
 void reset_text_color();                     // 重置文本颜色
 void set_console_charset();                  // 设置控制台字符集
 void clear_screen();                         // 清屏
+int replay_trace(const char *path);          // 无交互地回放二进制轨迹中的页面访问
 
 // 主函数 - 程序的入口点
-int main() {
+int main(int argc, char *argv[]) {
     // 设置控制台字符集
     set_console_charset();
     
+    // 带轨迹文件时无交互地回放，统计缺页率
+    if (argc == 3 && strcmp(argv[1], "--trace") == 0) {
+        return replay_trace(argv[2]);
+    }
+    if (argc > 1) {
+        printf("用法: %s [--trace 文件]\n", argv[0]);
+        printf("  --trace  无交互地回放dynamic_memory_management.c --generate生成的二进制轨迹中的页面访问\n");
+        return 1;
+    }
+    
     // 定义指令序列 - 模拟程序要执行的内存访问指令
     Instruction instructions[] = {
         {'+', 0, 72}, {'/', 1, 50}, {'x', 2, 15},
@@ -82,12 +126,12 @@ int main() {
         {'+', 2, 78}, {'-', 4, 1}, {'s', 6, 86}
     };
     
-    int physical_addr;  // 物理地址
+    long long physical_addr;  // 物理地址
     int page_fault;     // 缺页标志
     int victim_page;    // 被淘汰的页面
     
     // 记录每条指令的执行结果
-    int result_addresses[12];    // 存储每条指令的物理地址
+    long long result_addresses[12];  // 存储每条指令的物理地址
     int result_page_faults[12];  // 存储每条指令是否发生缺页
     int result_victims[12];      // 存储每条指令淘汰的页面
     
@@ -177,7 +221,7 @@ int main() {
     // 前6条指令和后6条指令并排显示
     for (int i = 0; i < 6; i++) {
         // 显示前6条指令的结果
-        printf("（%d）\t%d\t", i+1, result_addresses[i]);
+        printf("（%d）\t%lld\t", i+1, result_addresses[i]);
         
         if (result_page_faults[i]) {
             if (result_victims[i] != -1) {
@@ -190,7 +234,7 @@ int main() {
         }
         
         // 显示后6条指令的结果
-        printf("（%d）\t%d\t", i+7, result_addresses[i+6]);
+        printf("（%d）\t%lld\t", i+7, result_addresses[i+6]);
         
         if (result_page_faults[i+6]) {
             if (result_victims[i+6] != -1) {
@@ -279,7 +323,7 @@ void display_page_table() {
     // 打印每个页表项的信息
     for (int i = 0; i < MAX_PAGES; i++) {
         if (i < 7) {  // 只显示前7页的信息
-            printf("%d\t%d\t%d\t\t%d\t%d\t\t%d\n",
+            printf("%d\t%d\t%lld\t\t%d\t%d\t\t%d\n",
                    page_table[i].page_number,   // 页号
                    page_table[i].present,       // 存在标志
                    page_table[i].frame_number,  // 内存块号
@@ -292,13 +336,13 @@ void display_page_table() {
 }
 
 // 显示指令执行信息 - 打印指令执行的详细信息
-void display_instruction_info(int seq, Instruction inst, int physical_addr, int page_fault, int victim_page) {
+void display_instruction_info(int seq, Instruction inst, long long physical_addr, int page_fault, int victim_page) {
     printf("\n指令执行详细信息：\n");
     printf("序号：%d\n", seq);                 // 指令序号
     printf("操作：%c\n", inst.operation);      // 操作类型
     printf("页号：%d\n", inst.page_number);    // 页号
     printf("页内地址：%d\n", inst.offset);     // 页内偏移
-    printf("物理地址：%d\n", physical_addr);   // 计算得到的物理地址
+    printf("物理地址：%lld\n", physical_addr);   // 计算得到的物理地址
     
     // 显示缺页情况，使用不同颜色区分
     if (page_fault) {
@@ -317,7 +361,7 @@ void display_instruction_info(int seq, Instruction inst, int physical_addr, int
 }
 
 // 获取物理地址 - 根据逻辑地址计算物理地址
-int get_physical_address(Instruction inst) {
+long long get_physical_address(Instruction inst) {
     int page_number = inst.page_number;  // 页号
     int offset = inst.offset;            // 页内偏移
     
@@ -328,7 +372,7 @@ int get_physical_address(Instruction inst) {
 // 处理缺页中断 - 当页面不在内存时调用，返回被淘汰的页面号
 int handle_page_fault(int page_number) {
     int victim_page = -1;   // 被淘汰的页面，初始为-1表示无淘汰页面
-    int frame_number = -1;  // 分配的内存块号
+    long long frame_number = -1;  // 分配的内存块号
     
     // 优化空闲块检测：直接跟踪已使用的内存块
     int used_blocks[BLOCKS_PER_JOB] = {0};  // 记录内存块使用情况，0表示未使用
@@ -402,7 +446,7 @@ int find_victim_page() {
     
     // 精确跟踪每个内存块的装入时间
     for (int i = 0; i < BLOCKS_PER_JOB; i++) {
-        int current_block = memory_blocks[i];  // 当前检查的内存块
+        long long current_block = memory_blocks[i];  // 当前检查的内存块
         for (int j = 0; j < MAX_PAGES; j++) {
             // 找到在内存中且使用该内存块的页面
             if (page_table[j].present && page_table[j].frame_number == current_block) {
@@ -421,14 +465,21 @@ int find_victim_page() {
 
 // 保存页面到磁盘 - 模拟将页面内容写回磁盘
 void save_page_to_disk(int page_number) {
+    write_backs++;
+    if (quiet) {
+        return;
+    }
     printf("将页面 %d 写回磁盘位置 %d\n", 
            page_number, page_table[page_number].disk_location);
     // 实际操作在这里不需要实现，只是模拟
 }
 
 // 从磁盘加载页面 - 模拟从磁盘读取页面到内存
-void load_page_from_disk(int page_number, int frame_number) {
-    printf("从磁盘位置 %d 加载页面 %d 到内存块 %d\n",
+void load_page_from_disk(int page_number, long long frame_number) {
+    if (quiet) {
+        return;
+    }
+    printf("从磁盘位置 %d 加载页面 %d 到内存块 %lld\n",
            page_table[page_number].disk_location, page_number, frame_number);
     // 实际操作在这里不需要实现，只是模拟
 }
@@ -476,4 +527,101 @@ void set_console_charset() {
 // 清屏函数 - 清除控制台显示的内容
 void clear_screen() {
     system("cls");  // Windows系统使用cls命令清屏
-} 
\ No newline at end of file
+} 
+
+// 回放轨迹 - 映射二进制轨迹文件，按顺序执行其中的页面访问，统计缺页和写回次数
+// 所有进程共用作业的页表和内存块，超出页表范围的页号跳过并计数
+int replay_trace(const char *path) {
+    HANDLE file, mapping;
+    LARGE_INTEGER file_size, frequency, start, end;
+    const char *view;
+    const TraceHeader *header;
+    const TraceRecord *records;
+    long long accesses = 0, faults = 0, out_of_range = 0;  // 访问次数、缺页次数、跳过的访问次数
+    double elapsed;
+    
+    // 整个文件映射到内存，记录按下标直接读取
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        printf("无法打开轨迹文件: %s\n", path);
+        return 1;
+    }
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart < (long long)sizeof(TraceHeader)) {
+        printf("不是有效的轨迹文件: %s\n", path);
+        CloseHandle(file);
+        return 1;
+    }
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    view = mapping ? (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!view) {
+        printf("无法映射轨迹文件: %s\n", path);
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        return 1;
+    }
+    
+    header = (const TraceHeader *)view;
+    records = (const TraceRecord *)(view + sizeof(TraceHeader));
+    if (memcmp(header->magic, TRACE_MAGIC, sizeof(header->magic)) != 0 || header->version != TRACE_VERSION ||
+        header->record_count < 0 ||
+        header->record_count > (file_size.QuadPart - (long long)sizeof(TraceHeader)) / (long long)sizeof(TraceRecord)) {
+        printf("轨迹文件版本不符或已损坏: %s\n", path);
+    } else if (header->page_size != BLOCK_SIZE) {
+        printf("轨迹的页面大小(%lld字节)与内存块大小(%d字节)不同，请用--page-size %d生成轨迹\n",
+               header->page_size, BLOCK_SIZE, BLOCK_SIZE);
+    } else {
+        // 从与交互模式相同的初始状态开始
+        initialize_page_table();
+        initialize_memory_blocks();
+        current_time = 4;
+        write_backs = 0;
+        quiet = 1;
+        
+        QueryPerformanceFrequency(&frequency);
+        QueryPerformanceCounter(&start);
+        for (long long i = 0; i < header->record_count; i++) {
+            const TraceRecord *rec = &records[i];
+            int page_number = rec->data.access.page_number;
+            
+            if (rec->type != TRACE_ACCESS) {
+                continue;  // 分配和释放记录由动态分区程序回放
+            }
+            if (page_number < 0 || page_number >= MAX_PAGES) {
+                out_of_range++;
+                continue;
+            }
+            
+            accesses++;
+            if (!page_table[page_number].present) {
+                faults++;
+                handle_page_fault(page_number);
+            }
+            if (rec->operation == 's') {
+                page_table[page_number].modified = 1;
+            }
+        }
+        QueryPerformanceCounter(&end);
+        elapsed = (double)(end.QuadPart - start.QuadPart) / (double)frequency.QuadPart;
+        quiet = 0;
+        
+        printf("轨迹回放结果（%s，页面置换算法: FIFO，每个作业%d个内存块）\n", path, BLOCKS_PER_JOB);
+        printf("页面访问: %lld  缺页: %lld  缺页率: %.2f%%  写回磁盘: %lld\n",
+               accesses, faults, accesses > 0 ? 100.0 * faults / accesses : 0.0, write_backs);
+        if (out_of_range > 0) {
+            printf("跳过超出页表范围(0~%d)的访问: %lld\n", MAX_PAGES - 1, out_of_range);
+        }
+        printf("耗时: %.3fms，吞吐量: %.0f 次访问/秒\n", elapsed * 1000, elapsed > 0 ? accesses / elapsed : 0.0);
+        
+        UnmapViewOfFile(view);
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return 0;
+    }
+    
+    UnmapViewOfFile(view);
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return 1;
+}